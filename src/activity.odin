@@ -0,0 +1,264 @@
+package main
+
+// Mip-mapped activity summaries for the global activity bar and the minimap
+//
+// Level 0 splits the whole trace into a power-of-two number of time bins, and every level
+// above halves the bin count. Each bin holds how busy it was and the busy-weighted colour,
+// so drawing either view is one lookup per pixel at whichever level matches its width,
+// no matter how many threads or events are underneath. The trees are only walked once,
+// at load time, down to nodes that fit inside a single bin.
+//
+// The minimap draws a row per depth, so it needs a summary per depth, not just per thread.
+// Those share a fixed budget, so traces with lots of deep threads get fewer bins per depth.
+
+ACTIVITY_BINS           :: 2048 // for the whole-trace summary
+ACTIVITY_DEPTH_BINS     :: 512  // per depth, for the minimap, at most
+ACTIVITY_DEPTH_MIN_BINS :: 64
+ACTIVITY_DEPTH_BUDGET   :: 8 * 1024 * 1024 // bytes, for every depth's mip together
+
+// rgb is the average colour of whatever's in the bin, a is how much of the bin is busy
+ActivityMip :: struct {
+	levels: [][]BVec4,
+}
+
+// the whole trace is summed over threads, so it keeps the raw numbers
+ActivityBin :: struct {
+	busy:  f32,
+	color: FVec3,
+}
+TraceActivity :: struct {
+	levels: [][]ActivityBin,
+}
+
+activity_level_count :: proc(bin_count: int) -> int {
+	count := 1
+	for bins := bin_count; bins > 1; bins /= 2 {
+		count += 1
+	}
+	return count
+}
+
+// Picks the coarsest level that still has at least one bin per pixel
+activity_level_for_width :: proc(level_count, bin_count: int, width: f64) -> int {
+	level := 0
+	for level + 1 < level_count && f64(bin_count >> uint(level + 1)) >= width {
+		level += 1
+	}
+	return level
+}
+
+build_activity_summaries :: proc(trace: ^Trace) {
+	trace_duration := f64(trace.total_max_time - trace.total_min_time)
+	if trace_duration <= 0 {
+		trace.activity = {}
+		return
+	}
+
+	// a mip's levels add up to about twice its bottom one
+	depth_count := 0
+	for &proc_v in trace.processes {
+		for &tm in proc_v.threads {
+			depth_count += len(tm.depths)
+		}
+	}
+	depth_bin_count := ACTIVITY_DEPTH_BINS
+	for depth_bin_count > ACTIVITY_DEPTH_MIN_BINS && depth_count * depth_bin_count * 2 * size_of(BVec4) > ACTIVITY_DEPTH_BUDGET {
+		depth_bin_count /= 2
+	}
+
+	global_bins := make([]ActivityBin, ACTIVITY_BINS, big_global_allocator)
+	thread_bins := make([]ActivityBin, ACTIVITY_BINS, scratch_allocator)
+	depth_bins  := make([]ActivityBin, depth_bin_count, scratch_allocator)
+
+	for &proc_v in trace.processes {
+		for &tm in proc_v.threads {
+			for &depth, d_idx in tm.depths {
+				// the top depth gets splatted at full res for the whole-trace summary, and shrunk down for the minimap
+				if d_idx == 0 {
+					clear_bins(thread_bins)
+					splat_depth(trace, &tm, &depth, thread_bins, trace_duration)
+					for bin, i in thread_bins {
+						global_bins[i].busy  += bin.busy
+						global_bins[i].color += bin.color
+					}
+
+					clear_bins(depth_bins)
+					ratio := ACTIVITY_BINS / depth_bin_count
+					for bin, i in thread_bins {
+						depth_bins[i / ratio].busy  += bin.busy / f32(ratio)
+						depth_bins[i / ratio].color += bin.color / f32(ratio)
+					}
+				} else {
+					clear_bins(depth_bins)
+					splat_depth(trace, &tm, &depth, depth_bins, trace_duration)
+				}
+
+				depth.activity = build_depth_mip(depth_bins)
+			}
+		}
+	}
+
+	level_count := activity_level_count(ACTIVITY_BINS)
+	trace.activity.levels = make([][]ActivityBin, level_count, big_global_allocator)
+	trace.activity.levels[0] = global_bins
+	for l in 1..<level_count {
+		below := trace.activity.levels[l - 1]
+		level := make([]ActivityBin, len(below) / 2, big_global_allocator)
+		for &bin, i in level {
+			a := below[(i * 2)]
+			b := below[(i * 2) + 1]
+			bin.busy  = (a.busy + b.busy) / 2
+			bin.color = (a.color + b.color) / 2
+		}
+		trace.activity.levels[l] = level
+	}
+}
+
+clear_bins :: proc(bins: []ActivityBin) {
+	for &bin in bins {
+		bin = {}
+	}
+}
+
+build_depth_mip :: proc(bins: []ActivityBin) -> ActivityMip {
+	pack :: proc(bin: ActivityBin) -> BVec4 {
+		if bin.busy <= 0 {
+			return {}
+		}
+
+		color := bin.color / bin.busy
+		busy := min(bin.busy, 1)
+		return BVec4{u8(color.x), u8(color.y), u8(color.z), max(u8(busy * 255), 1)}
+	}
+
+	level_count := activity_level_count(len(bins))
+	mip := ActivityMip{}
+	mip.levels = make([][]BVec4, level_count, big_global_allocator)
+
+	// merge in f32 space first, so each level only gets rounded once
+	cur := bins
+	for l in 0..<level_count {
+		level := make([]BVec4, len(cur), big_global_allocator)
+		for bin, i in cur {
+			level[i] = pack(bin)
+		}
+		mip.levels[l] = level
+
+		if len(cur) > 1 {
+			for i in 0..<len(cur) / 2 {
+				a := cur[(i * 2)]
+				b := cur[(i * 2) + 1]
+				cur[i] = ActivityBin{(a.busy + b.busy) / 2, (a.color + b.color) / 2}
+			}
+			cur = cur[:len(cur) / 2]
+		}
+	}
+	return mip
+}
+
+// Adds [start, end) to the bins it covers, weighted by how much of each bin it covers
+splat_span :: proc(bins: []ActivityBin, bin_width: f64, start, end: f64, color: FVec3) {
+	first := max(int(start / bin_width), 0)
+	last  := min(int(end / bin_width), len(bins) - 1)
+	for b in first..=last {
+		bin_start := f64(b) * bin_width
+		overlap := min(end, bin_start + bin_width) - max(start, bin_start)
+		if overlap <= 0 {
+			continue
+		}
+
+		frac := f32(overlap / bin_width)
+		bins[b].busy  += frac
+		bins[b].color += color * frac
+	}
+}
+
+// Walks the tree down to nodes that fit in a bin, splatting those whole, and real events below that
+splat_depth :: proc(trace: ^Trace, thread: ^Thread, depth: ^Depth, bins: []ActivityBin, trace_duration: f64) {
+	tree := depth.tree
+	if len(tree) == 0 {
+		return
+	}
+	bin_width := trace_duration / f64(len(bins))
+
+	// If we blow this, we're in space
+	tree_stack := [128]int{}
+	stack_len := 0
+
+	tree_stack[0] = 0; stack_len += 1
+	for stack_len > 0 {
+		stack_len -= 1
+
+		tree_idx := tree_stack[stack_len]
+		cur_node := &tree[tree_idx]
+
+		if f64(cur_node.end_time - cur_node.start_time) <= bin_width {
+			splat_span(bins, bin_width, f64(cur_node.start_time), f64(cur_node.end_time), cur_node.avg_color)
+			continue
+		}
+
+		child_count := get_child_count(depth, tree_idx)
+		if child_count <= 0 {
+			event_start_idx, event_end_idx := get_event_range(depth, tree_idx)
+			for e_idx in event_start_idx..<event_end_idx {
+				ev := depth_event(depth, e_idx)
+				start := f64(ev.timestamp - trace.total_min_time)
+				end := start + f64(bound_duration(ev, thread.max_time))
+				splat_span(bins, bin_width, start, end, trace.color_choices[name_color_idx(ev.name)])
+			}
+			continue
+		}
+
+		for i := child_count; i > 0; i -= 1 {
+			tree_stack[stack_len] = get_left_child(tree_idx) + i - 1; stack_len += 1
+		}
+	}
+}
+
+// Draws a depth's summary into one minimap row
+draw_depth_activity :: proc(trace: ^Trace, depth: ^Depth, has_range, multiselecting: bool, x, w: f64) {
+	mip := &depth.activity
+	level := activity_level_for_width(len(mip.levels), len(mip.levels[0]), w)
+	bins := mip.levels[level]
+
+	trace_duration := f64(trace.total_max_time - trace.total_min_time)
+	bin_w := w / f64(len(bins))
+	bin_time := trace_duration / f64(len(bins))
+
+	// the summaries don't know about single events, so greying is per-row, or per-bin against the selection's time window
+	grey_row := (search_active(trace) && (len(depth.hit_bits) == 0 || !node_has_hit(depth, 0))) || (multiselecting && !has_range)
+
+	for bin, i in bins {
+		if bin.a == 0 {
+			continue
+		}
+
+		color := bin
+		bin_start := f64(i) * bin_time
+		in_selection := range_in_range(bin_start, bin_start + bin_time, trace.stats_start_time, trace.stats_end_time)
+		if grey_row || (multiselecting && !in_selection) {
+			grey := greyscale(FVec3{f32(bin.r), f32(bin.g), f32(bin.b)})
+			color = BVec4{u8(grey.x), u8(grey.y), u8(grey.z), 255}
+		}
+		color.a = 255
+
+		append(&gl_rects, DrawRect{f32(x + (f64(i) * bin_w)), f32(max(bin_w, 1)), color})
+	}
+}
+
+// Draws the whole-trace summary into the activity bar
+draw_trace_activity :: proc(trace: ^Trace, layer_count: int, x, w: f64) {
+	levels := trace.activity.levels
+	level := activity_level_for_width(len(levels), ACTIVITY_BINS, w)
+	bins := levels[level]
+
+	bin_w := w / f64(len(bins))
+	for bin, i in bins {
+		if bin.busy <= 0 {
+			continue
+		}
+
+		alpha := u8(min(bin.busy / f32(layer_count), 1) * 255)
+		append(&gl_rects, DrawRect{f32(x + (f64(i) * bin_w)), f32(max(bin_w, 1)), BVec4{wide_rect_color.x, wide_rect_color.y, wide_rect_color.z, max(alpha, 1)}})
+	}
+}
@@ -23,6 +23,9 @@ Arena :: struct {
 	offset:     int,
 	peak_used:  int,
 	temp_count: int,
+
+	// bytes left behind by resizes that had to move, since the last free_all
+	wasted:     int,
 }
 
 Arena_Temp_Memory :: struct {
@@ -30,11 +33,45 @@ Arena_Temp_Memory :: struct {
 	prev_offset: int,
 }
 
+// Everything allocated from the arena after begin gets thrown out by end,
+// so nothing that needs to outlive it can come from that arena in between
+arena_temp_begin :: proc(a: ^Arena) -> Arena_Temp_Memory {
+	return Arena_Temp_Memory{a, a.offset}
+}
+
+arena_temp_end :: proc(tmp: Arena_Temp_Memory) {
+	tmp.arena.offset = tmp.prev_offset
+}
+
 arena_init :: proc(a: ^Arena, data: []byte) {
 	a.data       = data
 	a.offset     = 0
 	a.peak_used  = 0
 	a.temp_count = 0
+	a.wasted     = 0
+}
+
+// is this the most recent allocation, sitting right at the end of the arena?
+arena_is_top :: proc(arena: ^Arena, old_memory: rawptr, old_size, alignment: int) -> bool {
+	if old_memory == nil || old_size == 0 {
+		return false
+	}
+	if uintptr(old_memory) % uintptr(alignment) != 0 {
+		return false
+	}
+
+	top := uintptr(raw_data(arena.data)) + uintptr(arena.offset)
+	return uintptr(old_memory) + uintptr(old_size) == top
+}
+
+arena_resize_top :: proc(arena: ^Arena, mode: mem.Allocator_Mode, old_memory: rawptr, old_size, size: int) -> []byte {
+	arena.offset = arena.offset - old_size + size
+	arena.peak_used = max(arena.peak_used, arena.offset)
+
+	if mode == .Resize && size > old_size {
+		mem.zero(rawptr(uintptr(old_memory) + uintptr(old_size)), size - old_size)
+	}
+	return mem.byte_slice(old_memory, size)
 }
 
 arena_allocator :: proc(arena: ^Arena) -> mem.Allocator {
@@ -80,16 +117,32 @@ arena_allocator_proc :: proc(
 
 	case .Free_All:
 		arena.offset = 0
+		arena.wasted = 0
+
+	case .Resize, .Resize_Non_Zeroed:
+		// if we're resizing the last thing we handed out, just move the offset
+		if arena_is_top(arena, old_memory, old_size, alignment) {
+			new_offset := arena.offset - old_size + size
+			if new_offset > len(arena.data) {
+				fmt.printf("Out of memory @ %s\n", location)
+				push_fatal(SpallError.OutOfMemory)
+			}
 
-	case .Resize:
-		return mem.default_resize_bytes_align(
-            mem.byte_slice(old_memory, old_size), size, alignment, arena_allocator(arena), location,
-        )
+			return arena_resize_top(arena, mode, old_memory, old_size, size), nil
+		}
 
-	case .Resize_Non_Zeroed:
+		if old_memory != nil {
+			arena.wasted += old_size
+		}
+
+		if mode == .Resize {
+			return mem.default_resize_bytes_align(
+				mem.byte_slice(old_memory, old_size), size, alignment, arena_allocator(arena), location,
+			)
+		}
 		return mem.default_resize_bytes_align_non_zeroed(
-            mem.byte_slice(old_memory, old_size), size, alignment, arena_allocator(arena), location,
-        )
+			mem.byte_slice(old_memory, old_size), size, alignment, arena_allocator(arena), location,
+		)
 
 	case .Query_Features:
 		set := (^mem.Allocator_Mode_Set)(old_memory)
@@ -116,6 +169,29 @@ growing_arena_init :: proc(a: ^Arena, loc := #caller_location) {
 	a.offset     = 0
 	a.peak_used  = 0
 	a.temp_count = 0
+	a.wasted     = 0
+}
+
+// Makes sure the arena's backing memory reaches at least end_offset.
+// big_global is the last thing in the wasm heap, so new pages land right after it.
+growing_arena_reserve :: proc(arena: ^Arena, end_offset: int, location := #caller_location) {
+	if end_offset <= len(arena.data) {
+		return
+	}
+
+	total_size := end_offset - arena.offset
+	page_count := mem.align_formula(end_offset - len(arena.data), PAGE_SIZE) / PAGE_SIZE
+	new_tail, err := page_alloc(page_count)
+	if err != nil {
+		fmt.printf("tried to get %M\n", total_size)
+		fmt.printf("OOM'd @ %M | %s\n", len(arena.data), location)
+
+		push_fatal(SpallError.OutOfMemory)
+	}
+
+	head_ptr := raw_data(arena.data)
+	#no_bounds_check arena.data = head_ptr[:u64(len(arena.data))+u64(len(new_tail))]
+	//fmt.printf("resized to %f MB\n", f64(u32(len(arena.data))) / 1024 / 1024)
 }
 
 growing_arena_allocator :: proc(arena: ^Arena) -> mem.Allocator {
@@ -142,20 +218,7 @@ growing_arena_allocator_proc :: proc(
 		align_skip := int(uintptr(ptr) - uintptr(end))
 		total_size := size + align_skip
 
-		if arena.offset + total_size > len(arena.data) {
-			page_count := mem.align_formula(total_size, PAGE_SIZE) / PAGE_SIZE
-			new_tail, err := page_alloc(page_count)
-			if err != nil {
-				fmt.printf("tried to get %M\n", total_size)
-				fmt.printf("OOM'd @ %M | %s\n", len(arena.data), location)
-
-				push_fatal(SpallError.OutOfMemory)
-			}
-
-			head_ptr := raw_data(arena.data)
-			#no_bounds_check arena.data = head_ptr[:u64(len(arena.data))+u64(len(new_tail))]
-			//fmt.printf("resized to %f MB\n", f64(u32(len(arena.data))) / 1024 / 1024)
-		}
+		growing_arena_reserve(arena, arena.offset + total_size, location)
 
 		arena.offset = arena.offset + total_size
 		arena.peak_used = max(arena.peak_used, arena.offset)
@@ -167,11 +230,22 @@ growing_arena_allocator_proc :: proc(
 
 	case .Free_All:
 		arena.offset = 0
+		arena.wasted = 0
 
-	case .Resize:
-		return mem.default_resize_bytes_align(mem.byte_slice(old_memory, old_size), size, alignment, growing_arena_allocator(arena), location)
+	case .Resize, .Resize_Non_Zeroed:
+		// if we're resizing the last thing we handed out, just move the offset (and grab more pages if we need them)
+		if arena_is_top(arena, old_memory, old_size, alignment) {
+			growing_arena_reserve(arena, arena.offset - old_size + size, location)
+			return arena_resize_top(arena, mode, old_memory, old_size, size), nil
+		}
+
+		if old_memory != nil {
+			arena.wasted += old_size
+		}
 
-	case .Resize_Non_Zeroed:
+		if mode == .Resize {
+			return mem.default_resize_bytes_align(mem.byte_slice(old_memory, old_size), size, alignment, growing_arena_allocator(arena), location)
+		}
 		return mem.default_resize_bytes_align_non_zeroed(mem.byte_slice(old_memory, old_size), size, alignment, growing_arena_allocator(arena), location)
 
 	case .Query_Features:
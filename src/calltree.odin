@@ -0,0 +1,522 @@
+package main
+
+import "core:fmt"
+import "core:slice"
+
+// Merged call tree (icicle view) over the selected ranges
+//
+// Every event in the selection lands on the trie node for its stack (the names of the
+// events containing it, one per depth above it). The trie lives in a fixed block of nodes
+// with a (parent, name) hash for child lookups, and gets filled a time-slice at a time by
+// walking each thread's depths in lockstep, the same way sweep_self_times does.
+//
+// The selected ranges are contiguous runs of events per depth, so when a selection moves
+// or narrows, only the events that fell in or out of each run need walking (with their
+// ancestors along for the ride), instead of rebuilding the whole tree.
+
+CALLTREE_MAX_NODES :: 1 << 19
+CALLTREE_HASH_SIZE :: 2 * CALLTREE_MAX_NODES
+CALLTREE_NONE      :: max(u32)
+
+CallNode :: struct {
+	name:         u32,
+	parent:       u32,
+	first_child:  u32,
+	next_sibling: u32,
+
+	count:      i32,
+	total_time: i64,
+	self_time:  i64,
+}
+
+// One depth's worth of a walk. Events in [visit_lo, visit_hi) get walked, so we can find
+// the stacks below them, but only [lo, hi) count towards the tree.
+CallWindow :: struct {
+	visit_lo: i32,
+	visit_hi: i32,
+	lo:       i32,
+	hi:       i32,
+	sign:     i32,
+	cursor:   i32,
+}
+
+CallJob :: struct {
+	pid: i32,
+	tid: i32,
+	first_window: i32,
+	depth_count:  i32,
+}
+
+CallFrame :: struct {
+	depth: i32,
+	node:  u32,
+	start: i64,
+	end:   i64,
+}
+
+CallTreeState :: enum {
+	Stale,
+	Building,
+	Ready,
+}
+
+CallTree :: struct {
+	nodes:      []CallNode,
+	node_count: int,
+	hashes:     []u32,
+	truncated:  bool,
+
+	state: CallTreeState,
+
+	// the ranges the tree will cover once all the queued jobs are done
+	covered: [dynamic]Range,
+	covered_start: f64,
+	covered_end:   f64,
+
+	jobs:    [dynamic]CallJob,
+	windows: [dynamic]CallWindow,
+	stack:   [dynamic]CallFrame,
+	cur_job: int,
+
+	done_events:  int,
+	total_events: int,
+
+	focus: u32,
+}
+
+init_calltree :: proc(trace: ^Trace) {
+	trace.calltree = CallTree{}
+	trace.calltree.covered = make([dynamic]Range, big_global_allocator)
+	trace.calltree.jobs    = make([dynamic]CallJob, big_global_allocator)
+	trace.calltree.windows = make([dynamic]CallWindow, big_global_allocator)
+	trace.calltree.stack   = make([dynamic]CallFrame, big_global_allocator)
+}
+
+calltree_reset :: proc(trace: ^Trace) {
+	ct := &trace.calltree
+
+	// only grab the big blocks once somebody actually opens the view
+	if ct.nodes == nil {
+		ct.nodes  = make([]CallNode, CALLTREE_MAX_NODES, big_global_allocator)
+		ct.hashes = make([]u32, CALLTREE_HASH_SIZE, big_global_allocator)
+	}
+	slice.fill(ct.hashes, CALLTREE_NONE)
+
+	// node 0 is the root, everything's depth 0 hangs off it
+	ct.nodes[0] = CallNode{parent = CALLTREE_NONE, first_child = CALLTREE_NONE, next_sibling = CALLTREE_NONE}
+	ct.node_count = 1
+	ct.truncated = false
+	ct.focus = 0
+
+	non_zero_resize(&ct.covered, 0)
+	non_zero_resize(&ct.jobs, 0)
+	non_zero_resize(&ct.windows, 0)
+	non_zero_resize(&ct.stack, 0)
+	ct.cur_job = 0
+	ct.done_events = 0
+	ct.total_events = 0
+}
+
+calltree_hash :: #force_inline proc(parent, name: u32) -> u32 {
+	return ((parent * 0x9E3779B1) ~ (name * 0x85EBCA77)) & (CALLTREE_HASH_SIZE - 1)
+}
+
+calltree_child :: proc(ct: ^CallTree, parent, name: u32) -> u32 {
+	if parent == CALLTREE_NONE {
+		return CALLTREE_NONE
+	}
+
+	hv := calltree_hash(parent, name)
+	for {
+		n_idx := ct.hashes[hv]
+		if n_idx == CALLTREE_NONE {
+			break
+		}
+
+		node := &ct.nodes[n_idx]
+		if node.parent == parent && node.name == name {
+			return n_idx
+		}
+		hv = (hv + 1) & (CALLTREE_HASH_SIZE - 1)
+	}
+
+	// out of room, the stacks below here just won't show up
+	if ct.node_count >= CALLTREE_MAX_NODES {
+		ct.truncated = true
+		return CALLTREE_NONE
+	}
+
+	n_idx := u32(ct.node_count)
+	ct.node_count += 1
+
+	parent_node := &ct.nodes[parent]
+	ct.nodes[n_idx] = CallNode{
+		name         = name,
+		parent       = parent,
+		first_child  = CALLTREE_NONE,
+		next_sibling = parent_node.first_child,
+	}
+	parent_node.first_child = n_idx
+	ct.hashes[hv] = n_idx
+	return n_idx
+}
+
+// Called whenever the selected ranges change
+calltree_selection_changed :: proc(trace: ^Trace, ui_state: ^UIState) {
+	ct := &trace.calltree
+	if !ui_state.calltree_open {
+		ct.state = .Stale
+		return
+	}
+
+	if ct.state == .Stale || !queue_calltree_deltas(trace) {
+		queue_calltree_rebuild(trace)
+	}
+
+	non_zero_resize(&ct.covered, 0)
+	for range in trace.selected_ranges {
+		non_zero_append(&ct.covered, range)
+	}
+	ct.covered_start = trace.stats_start_time
+	ct.covered_end   = trace.stats_end_time
+	ct.state = .Building
+}
+
+queue_calltree_rebuild :: proc(trace: ^Trace) {
+	ct := &trace.calltree
+	calltree_reset(trace)
+
+	ranges := trace.selected_ranges[:]
+	for i := 0; i < len(ranges); {
+		// ranges come out grouped by thread, in depth order
+		j := i
+		for j < len(ranges) && ranges[j].pid == ranges[i].pid && ranges[j].tid == ranges[i].tid {
+			j += 1
+		}
+
+		job := CallJob{ranges[i].pid, ranges[i].tid, i32(len(ct.windows)), ranges[j - 1].did + 1}
+		for d in 0..<job.depth_count {
+			non_zero_append(&ct.windows, CallWindow{})
+		}
+		for range in ranges[i:j] {
+			ct.windows[int(job.first_window) + int(range.did)] = CallWindow{range.start, range.end, range.start, range.end, 1, range.start}
+			ct.total_events += int(range.end - range.start)
+		}
+		non_zero_append(&ct.jobs, job)
+
+		i = j
+	}
+}
+
+// Queues up walks for just the events that moved in or out of the selection.
+// Returns false if the change is too big (or too different) to be worth it.
+queue_calltree_deltas :: proc(trace: ^Trace) -> bool {
+	ct := &trace.calltree
+	old_ranges := ct.covered[:]
+	new_ranges := trace.selected_ranges[:]
+
+	// the walks lean on ancestors sitting in both the old and new runs, so the selections need to overlap
+	if !range_in_range(trace.stats_start_time, trace.stats_end_time, ct.covered_start, ct.covered_end) {
+		return false
+	}
+	if len(old_ranges) != len(new_ranges) {
+		return false
+	}
+
+	delta_events := 0
+	new_events := 0
+	for range, i in new_ranges {
+		old := old_ranges[i]
+		if old.pid != range.pid || old.tid != range.tid || old.did != range.did {
+			return false
+		}
+
+		delta_events += int(abs(range.start - old.start) + abs(range.end - old.end))
+		new_events += int(range.end - range.start)
+	}
+	if delta_events >= new_events {
+		return false
+	}
+
+	// jobs that are already done can go, their windows aren't needed anymore
+	if ct.cur_job >= len(ct.jobs) {
+		non_zero_resize(&ct.jobs, 0)
+		non_zero_resize(&ct.windows, 0)
+		ct.cur_job = 0
+		ct.done_events = 0
+		ct.total_events = 0
+	}
+
+	for i := 0; i < len(new_ranges); {
+		j := i
+		for j < len(new_ranges) && new_ranges[j].pid == new_ranges[i].pid && new_ranges[j].tid == new_ranges[i].tid {
+			j += 1
+		}
+		depth_count := new_ranges[j - 1].did + 1
+
+		// one walk for each edge
+		for side in 0..<2 {
+			job := CallJob{new_ranges[i].pid, new_ranges[i].tid, i32(len(ct.windows)), depth_count}
+			for d in 0..<depth_count {
+				non_zero_append(&ct.windows, CallWindow{})
+			}
+
+			for r_idx in i..<j {
+				range := new_ranges[r_idx]
+				old := old_ranges[r_idx]
+				union_start := min(range.start, old.start)
+				union_end   := max(range.end, old.end)
+
+				w := CallWindow{}
+				if side == 0 {
+					w.lo = min(range.start, old.start)
+					w.hi = max(range.start, old.start)
+					w.sign = range.start < old.start ? 1 : -1
+
+					// the event straddling the edge might be an ancestor of the ones that moved
+					w.visit_lo = w.lo
+					w.visit_hi = min(w.hi + 1, union_end)
+				} else {
+					w.lo = min(range.end, old.end)
+					w.hi = max(range.end, old.end)
+					w.sign = range.end > old.end ? 1 : -1
+
+					w.visit_lo = max(w.lo - 1, union_start)
+					w.visit_hi = w.hi
+				}
+				w.cursor = w.visit_lo
+
+				ct.windows[int(job.first_window) + int(range.did)] = w
+				ct.total_events += int(w.visit_hi - w.visit_lo)
+			}
+			non_zero_append(&ct.jobs, job)
+		}
+
+		i = j
+	}
+
+	return true
+}
+
+// Pushes the event onto the walk, and counts it if it's inside its window's [lo, hi)
+calltree_visit :: proc(trace: ^Trace, thread: ^Thread, w: ^CallWindow, d_idx: int, e_idx: int, parent: u32) {
+	ct := &trace.calltree
+	depth := &thread.depths[d_idx]
+
+	ev := depth_event(depth, e_idx)
+	start := ev.timestamp
+	duration := bound_duration(ev, thread.max_time)
+
+	node := calltree_child(ct, parent, ev.name)
+	if node != CALLTREE_NONE && i32(e_idx) >= w.lo && i32(e_idx) < w.hi {
+		n := &ct.nodes[node]
+		n.count      += w.sign
+		n.total_time += i64(w.sign) * duration
+		n.self_time  += i64(w.sign) * get_self_time(trace, thread, d_idx, e_idx)
+	}
+
+	non_zero_append(&ct.stack, CallFrame{i32(d_idx), node, start, start + duration})
+}
+
+process_calltree :: proc(trace: ^Trace, ui_state: ^UIState) {
+	ct := &trace.calltree
+	if ct.state != .Building {
+		return
+	}
+	ui_state.render_one_more = true
+
+	iter_max := FULL_ITER
+	event_count := 0
+	for ct.cur_job < len(ct.jobs) {
+		job := ct.jobs[ct.cur_job]
+		thread := &trace.processes[job.pid].threads[job.tid]
+		windows := ct.windows[job.first_window:job.first_window + job.depth_count]
+
+		for {
+			if event_count >= iter_max {
+				return
+			}
+
+			// nothing open, move on to the next top-level event
+			if len(ct.stack) == 0 {
+				w := &windows[0]
+				if w.cursor >= w.visit_hi {
+					break
+				}
+
+				calltree_visit(trace, thread, w, 0, int(w.cursor), 0)
+				w.cursor += 1
+				event_count += 1
+				continue
+			}
+
+			top := ct.stack[len(ct.stack) - 1]
+			child_d := int(top.depth) + 1
+			if child_d >= len(windows) {
+				pop(&ct.stack)
+				continue
+			}
+
+			// anything starting before the open event isn't one of its children
+			w := &windows[child_d]
+			child_depth := &thread.depths[child_d]
+			for w.cursor < w.visit_hi && event_start(child_depth, int(w.cursor)) < top.start {
+				w.cursor += 1
+				event_count += 1
+			}
+
+			if w.cursor < w.visit_hi && event_start(child_depth, int(w.cursor)) < top.end {
+				calltree_visit(trace, thread, w, child_d, int(w.cursor), top.node)
+				w.cursor += 1
+				event_count += 1
+			} else {
+				pop(&ct.stack)
+			}
+		}
+
+		for w in windows {
+			ct.done_events += int(w.visit_hi - w.visit_lo)
+		}
+		ct.cur_job += 1
+	}
+
+	ct.state = .Ready
+}
+
+calltree_node_color :: proc(trace: ^Trace, node: ^CallNode) -> BVec4 {
+	c := trace.color_choices[name_color_idx(node.name)]
+	return BVec4{u8(c.x), u8(c.y), u8(c.z), 255}
+}
+
+// Draws the tree as an icicle, the focused node across the top, its callees underneath
+draw_calltree :: proc(trace: ^Trace, ui_state: ^UIState, pane: Rect) {
+	ct := &trace.calltree
+
+	if ct.state != .Ready {
+		loading_str := "Call tree loading..."
+		progress_str := fmt.tprintf("%d of %d", ct.done_events, ct.total_events)
+
+		center_x := pane.x + (pane.w / 2)
+		y := pane.y + (pane.h / 2) - em
+		draw_text(loading_str, Vec2{center_x - (measure_text(loading_str, .PSize, .DefaultFont) / 2), next_line(&y, em)}, .PSize, .DefaultFont, text_color)
+		draw_text(progress_str, Vec2{center_x - (measure_text(progress_str, .PSize, .DefaultFont) / 2), next_line(&y, em)}, .PSize, .DefaultFont, text_color)
+		return
+	}
+
+	row_height := ui_state.rect_height
+	row_gap := 1.0
+
+	focus := ct.focus
+	focus_total : i64 = 0
+	if focus == 0 {
+		for c := ct.nodes[0].first_child; c != CALLTREE_NONE; c = ct.nodes[c].next_sibling {
+			focus_total += max(ct.nodes[c].total_time, 0)
+		}
+	} else {
+		focus_total = ct.nodes[focus].total_time
+	}
+	if focus_total <= 0 {
+		return
+	}
+
+	x_scale := pane.w / f64(focus_total)
+	top_y := pane.y + ui_state.stats_pane_scroll_pos
+
+	IcicleItem :: struct {
+		node: u32,
+		x: f64,
+		level: int,
+	}
+	stack := make([dynamic]IcicleItem, context.temp_allocator)
+
+	max_level := 0
+	hovered := CALLTREE_NONE
+	hovered_rect := Rect{}
+
+	push_children :: proc(ct: ^CallTree, stack: ^[dynamic]IcicleItem, node: u32, x, x_scale: f64, level: int) {
+		cur_x := x
+		for c := ct.nodes[node].first_child; c != CALLTREE_NONE; c = ct.nodes[c].next_sibling {
+			child := &ct.nodes[c]
+			if child.count <= 0 || child.total_time <= 0 {
+				continue
+			}
+
+			append(stack, IcicleItem{c, cur_x, level})
+			cur_x += f64(child.total_time) * x_scale
+		}
+	}
+
+	if focus == 0 {
+		push_children(ct, &stack, 0, pane.x, x_scale, 0)
+	} else {
+		append(&stack, IcicleItem{focus, pane.x, 0})
+	}
+
+	for len(stack) > 0 {
+		item := pop(&stack)
+		node := &ct.nodes[item.node]
+
+		w := f64(node.total_time) * x_scale
+		if w < 1 {
+			continue
+		}
+
+		max_level = max(max_level, item.level)
+		y := top_y + (f64(item.level) * (row_height + row_gap))
+		if y > pane.y + pane.h {
+			continue
+		}
+
+		dr := Rect{item.x, y, w, row_height}
+		if y + row_height >= pane.y {
+			color := calltree_node_color(trace, node)
+			draw_rect(dr, color)
+
+			name := in_getstr(&trace.string_block, node.name)
+			name_str := trunc_string(name, em / 2, w)
+			if len(name_str) > 0 {
+				draw_text(name_str, Vec2{dr.x + (em / 2), dr.y + (row_height / 2) - (em / 2)}, .PSize, .MonoFont, text_color3)
+			}
+
+			if pt_in_rect(mouse_pos, pane) && pt_in_rect(mouse_pos, dr) {
+				hovered = item.node
+				hovered_rect = dr
+			}
+		}
+
+		push_children(ct, &stack, item.node, item.x, x_scale, item.level + 1)
+	}
+
+	// we only find out how deep things go by drawing them, so the scroll limit catches up a frame late
+	max_scroll := max((f64(max_level + 1) * (row_height + row_gap)) - pane.h, 0)
+	ui_state.stats_pane_scroll_pos = max(ui_state.stats_pane_scroll_pos, -max_scroll)
+
+	if hovered != CALLTREE_NONE {
+		set_cursor("pointer")
+
+		// clicking a node zooms in on it, clicking the node we're zoomed on backs out a level
+		if clicked && pt_in_rect(clicked_pos, hovered_rect) {
+			if hovered == ct.focus {
+				parent := ct.nodes[hovered].parent
+				ct.focus = parent == CALLTREE_NONE ? 0 : parent
+			} else {
+				ct.focus = hovered
+			}
+		}
+
+		node := &ct.nodes[hovered]
+		tip := fmt.tprintf("%s - total: %s, self: %s, calls: %d",
+			in_getstr(&trace.string_block, node.name),
+			time_fmt(disp_time(trace, f64(node.total_time))),
+			time_fmt(disp_time(trace, f64(node.self_time))),
+			node.count,
+		)
+		tooltip(Vec2{mouse_pos.x, hovered_rect.y + row_height + (em / 2)}, pane.x, pane.x + pane.w, tip)
+	}
+
+	if ct.truncated {
+		warn_str := "call tree is too big, some stacks are missing"
+		warn_width := measure_text(warn_str, .PSize, .DefaultFont)
+		draw_text(warn_str, Vec2{pane.x + pane.w - warn_width, pane.y + pane.h - em}, .PSize, .DefaultFont, text_color2)
+	}
+}
@@ -18,15 +18,15 @@ FileType :: enum {
 	AutoStream,
 }
 
-find_idx :: proc(trace: ^Trace, events: []Event, val: i64) -> int {
+find_idx :: proc(trace: ^Trace, depth: ^Depth, val: i64) -> int {
 	low := 0
-	max := len(events)
+	max := depth_len(depth)
 	high := max - 1
 
 	for low < high {
 		mid := (low + high) / 2
 
-		ev := events[mid]
+		ev := depth_event(depth, mid)
 		ev_start := ev.timestamp - trace.total_min_time
 		ev_end := ev_start + ev.duration
 
@@ -55,13 +55,11 @@ manual_load :: proc(config, name: string) {
 	load_config_chunk(transmute([]u8)config)
 }
 
-gen_event_color :: proc(trace: ^Trace, _events: []Event, thread_max: i64, node: ^ChunkNode) {
+gen_event_color :: proc(trace: ^Trace, depth: ^Depth, start_idx, end_idx: int, thread_max: i64, node: ^ChunkNode) {
 	total_weight : i64 = 0
 
-	events := _events
-
-	if len(events) == 1 {
-		ev := &events[0]
+	if end_idx - start_idx == 1 {
+		ev := depth_event(depth, start_idx)
 		duration := bound_duration(ev, thread_max)
 		idx := name_color_idx(ev.name)
 		node.avg_color = trace.color_choices[idx]
@@ -74,9 +72,10 @@ gen_event_color :: proc(trace: ^Trace, _events: []Event, thread_max: i64, node:
 
 	color := FVec3{}
 	color_weights := [COLOR_CHOICES]i64{}
-	for &ev in events {
+	for i in start_idx..<end_idx {
+		ev := depth_event(depth, i)
 		idx := name_color_idx(ev.name)
-		duration := bound_duration(&ev, thread_max)
+		duration := bound_duration(ev, thread_max)
 
 		color_weights[idx] += duration
 		total_weight += duration
@@ -124,6 +123,7 @@ print_tree :: proc(depth: ^Depth) {
 }
 
 chunk_events :: proc(trace: ^Trace) {
+	render_gen += 1
 	lod_mem_usage := 0
 	ev_mem_usage := 0
 
@@ -131,106 +131,218 @@ chunk_events :: proc(trace: ^Trace) {
 	for &proc_v, p_idx in trace.processes {
 		for &tm, t_idx in proc_v.threads {
 			for &depth, d_idx in tm.depths {
-				leaf_count := i_round_up(len(depth.events), BUCKET_SIZE) / BUCKET_SIZE
-				depth.leaf_count = leaf_count
+				build_depth_lod(trace, &tm, &depth)
 
-				width := CHUNK_NARY_WIDTH - 1
-				internal_node_count := i_round_up((leaf_count - 1), width) / width
-				total_node_count := internal_node_count + leaf_count
+				lod_mem_usage += size_of(ChunkNode) * len(depth.tree)
+				ev_mem_usage += depth_mem_usage(&depth)
+			}
+		}
+	}
 
-				tm.depths[d_idx].tree = make([]ChunkNode, total_node_count, big_global_allocator)
-				zero_slice(tm.depths[d_idx].tree)
+	trace.lod_min_time = trace.total_min_time
+	fmt.printf("LOD memory: %M | Event memory: %M\n", lod_mem_usage, ev_mem_usage)
+}
 
-				lod_mem_usage += size_of(ChunkNode) * total_node_count
-				ev_mem_usage += size_of(Event) * len(depth.events)
+// Builds the LOD over every event the depth has right now.
+// Events pushed afterwards land in the last leaf, see patch_lod_spine.
+build_depth_lod :: proc(trace: ^Trace, tm: ^Thread, depth: ^Depth) {
+	event_count := depth_len(depth)
+	depth.tree_event_count = event_count
+	depth.open_leaf_weights = {}
+	if event_count == 0 {
+		depth.tree = nil
+		depth.leaf_count = 0
+		depth.overhang_len = 0
+		depth.full_leaves = 0
+		depth.open_leaf_folded = 0
+		return
+	}
 
-				tree := tm.depths[d_idx].tree
-				tree_start_idx := len(tree) - leaf_count
+	leaf_count := i_round_up(event_count, BUCKET_SIZE) / BUCKET_SIZE
+	depth.leaf_count = leaf_count
+	depth.open_leaf_folded = (leaf_count - 1) * BUCKET_SIZE
 
-				cur_node := 0
-				overhang_idx := 0
-				prehang_rank := 0
-				for ; cur_node < total_node_count; {
-					overhang_idx = cur_node
-					cur_node = (CHUNK_NARY_WIDTH * cur_node) + 1
+	width := CHUNK_NARY_WIDTH - 1
+	internal_node_count := i_round_up((leaf_count - 1), width) / width
+	total_node_count := internal_node_count + leaf_count
 
-					prehang_rank += 1
-				}
+	depth.tree = reuse_slice(&depth.tree_buf, total_node_count)
+	zero_slice(depth.tree)
 
-				posthang_rank := 1
-				tmp_idx := len(tree) - leaf_count
-				for ; tmp_idx > 0; {
-					tmp_idx = (tmp_idx - 1) / CHUNK_NARY_WIDTH
-					posthang_rank += 1
-				}
+	tree := depth.tree
+	tree_start_idx := len(tree) - leaf_count
 
-				_tmp := 1
-				for _tmp < leaf_count {
-					_tmp = _tmp * CHUNK_NARY_WIDTH
-				}
-				depth.full_leaves = _tmp
+	cur_node := 0
+	overhang_idx := 0
+	prehang_rank := 0
+	for ; cur_node < total_node_count; {
+		overhang_idx = cur_node
+		cur_node = (CHUNK_NARY_WIDTH * cur_node) + 1
 
-				overhang_len := len(tree) - overhang_idx
-				if prehang_rank == posthang_rank {
-					overhang_len = 0
-				}
-				depth.overhang_len = overhang_len
+		prehang_rank += 1
+	}
 
-				for i := 0; i < overhang_len; i += 1 {
-					start_idx := i * BUCKET_SIZE
-					end_idx := start_idx + min(len(depth.events) - start_idx, BUCKET_SIZE)
-					scan_arr := depth.events[start_idx:end_idx]
+	posthang_rank := 1
+	tmp_idx := len(tree) - leaf_count
+	for ; tmp_idx > 0; {
+		tmp_idx = (tmp_idx - 1) / CHUNK_NARY_WIDTH
+		posthang_rank += 1
+	}
 
-					start_ev := &scan_arr[0]
-					end_ev := &scan_arr[len(scan_arr)-1]
-					tree_idx := overhang_idx + i
+	_tmp := 1
+	for _tmp < leaf_count {
+		_tmp = _tmp * CHUNK_NARY_WIDTH
+	}
+	depth.full_leaves = _tmp
 
-					node := &tree[tree_idx]
-					node.start_time = start_ev.timestamp - trace.total_min_time
-					node.end_time   = end_ev.timestamp + bound_duration(end_ev, tm.max_time) - trace.total_min_time
-					gen_event_color(trace, scan_arr, tm.max_time, node)
+	overhang_len := len(tree) - overhang_idx
+	if prehang_rank == posthang_rank {
+		overhang_len = 0
+	}
+	depth.overhang_len = overhang_len
 
-				}
+	for i := 0; i < leaf_count; i += 1 {
+		build_lod_leaf(trace, tm, depth, i)
+	}
 
-				previous_len := leaf_count - overhang_len
-				ev_offset := overhang_len * BUCKET_SIZE
-				for i := 0; i < previous_len; i += 1 {
-					start_idx := (i * BUCKET_SIZE) + ev_offset
-					end_idx := start_idx + min(len(depth.events) - start_idx, BUCKET_SIZE)
-					scan_arr := depth.events[start_idx:end_idx]
-
-					start_ev := &scan_arr[0]
-					end_ev := &scan_arr[len(scan_arr)-1]
-					tree_idx := tree_start_idx + i
-
-					node := &tree[tree_idx]
-					node.start_time = start_ev.timestamp - trace.total_min_time
-					node.end_time   = end_ev.timestamp + bound_duration(end_ev, tm.max_time) - trace.total_min_time
-					gen_event_color(trace, scan_arr, tm.max_time, node)
-				}
+	for i := tree_start_idx - 1; i >= 0; i -= 1 {
+		merge_lod_children(depth, i)
+	}
+}
 
-				avg_color := FVec3{}
-				for i := tree_start_idx - 1; i >= 0; i -= 1 {
-					node := &tree[i]
+// maps a leaf's position in event order back to its slot in the tree, see linearize_leaf
+leaf_tree_idx :: proc(depth: ^Depth, linear_idx: int) -> int {
+	overhang_start := len(depth.tree) - depth.overhang_len
+	leaf_start := len(depth.tree) - depth.leaf_count
 
-					start_idx := (CHUNK_NARY_WIDTH * i) + 1
-					end_idx := min(start_idx + (CHUNK_NARY_WIDTH - 1), len(tree) - 1)
+	if depth.overhang_len == 0 {
+		return leaf_start + linear_idx
+	} else if linear_idx < depth.overhang_len {
+		return overhang_start + linear_idx
+	}
+	return leaf_start + (linear_idx - depth.overhang_len)
+}
+
+build_lod_leaf :: proc(trace: ^Trace, tm: ^Thread, depth: ^Depth, linear_idx: int) {
+	start_idx := linear_idx * BUCKET_SIZE
+	end_idx := start_idx + min(depth.tree_event_count - start_idx, BUCKET_SIZE)
+
+	start_ev := depth_event(depth, start_idx)
+	end_ev := depth_event(depth, end_idx - 1)
+
+	node := &depth.tree[leaf_tree_idx(depth, linear_idx)]
+	node.start_time = start_ev.timestamp - trace.total_min_time
+	node.end_time   = end_ev.timestamp + bound_duration(end_ev, tm.max_time) - trace.total_min_time
+	gen_event_color(trace, depth, start_idx, end_idx, tm.max_time, node)
+}
+
+merge_lod_children :: proc(depth: ^Depth, idx: int) {
+	tree := depth.tree
+	node := &tree[idx]
+
+	start_idx := (CHUNK_NARY_WIDTH * idx) + 1
+	end_idx := min(start_idx + (CHUNK_NARY_WIDTH - 1), len(tree) - 1)
+
+	node.start_time = tree[start_idx].start_time
+	node.end_time   = tree[end_idx].end_time
+	node.weight     = 0
+
+	avg_color := FVec3{}
+	for j := start_idx; j <= end_idx; j += 1 {
+		avg_color += tree[j].avg_color * f32(tree[j].weight)
+		node.weight += tree[j].weight
+	}
+	node.avg_color = avg_color / f32(node.weight)
+}
 
-					node.start_time = tree[start_idx].start_time
-					node.end_time   = tree[end_idx].end_time
+// Called between chunks of a streaming load, so we can draw what we've got so far.
+// Depths that haven't grown enough for a rebuild just get their right spine patched,
+// so new and open events keep up with the frontier.
+progressive_build_lods :: proc(trace: ^Trace) {
+	self_trace_begin("progressive_build_lods")
+	defer self_trace_end()
 
-					avg_color = {}
-					for j := start_idx; j <= end_idx; j += 1 {
-						avg_color += tree[j].avg_color * f32(tree[j].weight)
-						node.weight += tree[j].weight
-					}
-					node.avg_color = avg_color / f32(node.weight)
+	render_gen += 1
+	if trace.event_count == 0 {
+		return
+	}
+
+	// every node is stored relative to total_min_time, if that moved everything's stale
+	min_time_moved := trace.lod_min_time != trace.total_min_time
+	trace.lod_min_time = trace.total_min_time
+
+	for &proc_v in trace.processes {
+		for &tm in proc_v.threads {
+			for &depth in tm.depths {
+				if min_time_moved || lod_needs_rebuild(&depth) {
+					build_depth_lod(trace, &tm, &depth)
+				} else {
+					patch_lod_spine(trace, &tm, &depth)
 				}
 			}
 		}
 	}
 
-	fmt.printf("LOD memory: %M | Event memory: %M\n", lod_mem_usage, ev_mem_usage)
+	if !trace.progressive {
+		trace.progressive = true
+		post_loading = true
+	}
+}
+
+// A depth only gets rebuilt once its last leaf has grown by a quarter of the rest of the tree,
+// which keeps the total rebuild work linear in the event count.
+lod_needs_rebuild :: proc(depth: ^Depth) -> bool {
+	if depth.leaf_count == 0 {
+		return depth_len(depth) > 0
+	}
+
+	open_len := depth_len(depth) - ((depth.leaf_count - 1) * BUCKET_SIZE)
+	return (open_len - BUCKET_SIZE) >= ((depth.leaf_count * BUCKET_SIZE) / 4)
+}
+
+// Between builds, new events all go into the last leaf, so it can hold more than BUCKET_SIZE.
+// Only a depth's last event can still be open, so everything before that gets folded into
+// the leaf's running color weights once, and a patch only costs the new events plus the spine.
+patch_lod_spine :: proc(trace: ^Trace, tm: ^Thread, depth: ^Depth) {
+	if depth.leaf_count == 0 {
+		return
+	}
+
+	event_count := depth_len(depth)
+	depth.tree_event_count = event_count
+
+	last_idx := event_count - 1
+	for ; depth.open_leaf_folded < last_idx; depth.open_leaf_folded += 1 {
+		ev := depth_event(depth, depth.open_leaf_folded)
+		depth.open_leaf_weights[name_color_idx(ev.name)] += bound_duration(ev, tm.max_time)
+	}
+
+	linear_idx := depth.leaf_count - 1
+	start_ev := depth_event(depth, linear_idx * BUCKET_SIZE)
+	end_ev := depth_event(depth, last_idx)
+	end_duration := bound_duration(end_ev, tm.max_time)
+
+	node := &depth.tree[leaf_tree_idx(depth, linear_idx)]
+	node.start_time = start_ev.timestamp - trace.total_min_time
+	node.end_time   = end_ev.timestamp + end_duration - trace.total_min_time
+
+	// same as gen_event_color, an open event that just started still gets *some* weight
+	weights := depth.open_leaf_weights
+	weights[name_color_idx(end_ev.name)] += max(end_duration, 1)
+
+	color := FVec3{}
+	node.weight = 0
+	for weight, idx in weights {
+		color += trace.color_choices[idx] * f32(weight)
+		node.weight += weight
+	}
+	node.avg_color = color / f32(node.weight)
+
+	tree_idx := leaf_tree_idx(depth, linear_idx)
+	for tree_idx > 0 {
+		tree_idx = (tree_idx - 1) / CHUNK_NARY_WIDTH
+		merge_lod_children(depth, tree_idx)
+	}
 }
 
 get_left_child :: #force_inline proc(idx: int) -> int {
@@ -264,15 +376,9 @@ get_event_count :: proc(depth: ^Depth, idx: int) -> int {
 	linear_idx := linearize_leaf(depth, idx)
 
 	ret := BUCKET_SIZE
-	// if we're the last index in the tree, determine the leftover
+	// if we're the last index in the tree, it gets whatever's left, which can be more than a bucket
 	if linear_idx == (depth.leaf_count - 1) {
-		ret = len(depth.events) % BUCKET_SIZE
-
-
-		// If we fall exactly in the bucket?
-		if ret == 0 {
-			ret = BUCKET_SIZE
-		}
+		ret = depth.tree_event_count - (linear_idx * BUCKET_SIZE)
 	}
 
 	return ret
@@ -341,6 +447,27 @@ get_event_range :: proc(depth: ^Depth, idx: int) -> (int, int) {
 	return start, end
 }
 
+// The last leaf can hold a whole lot of events between builds (see patch_lod_spine),
+// so leaf scans that only care about a window skip ahead to it with this first.
+// Events at one depth never overlap, so their ends are sorted as well as their starts.
+first_event_ending_after :: proc(trace: ^Trace, depth: ^Depth, thread_max: i64, start_idx, end_idx: int, time: i64) -> int {
+	low := start_idx
+	high := end_idx
+	for low < high {
+		mid := (low + high) / 2
+
+		ev := depth_event(depth, mid)
+		ev_end := ev.timestamp + bound_duration(ev, thread_max) - trace.total_min_time
+		if ev_end < time {
+			low = mid + 1
+		} else {
+			high = mid
+		}
+	}
+
+	return low
+}
+
 instant_count := 0
 first_chunk: bool
 init_loading_state :: proc(trace: ^Trace, size: u64, name: string) {
@@ -377,6 +504,15 @@ init_loading_state :: proc(trace: ^Trace, size: u64, name: string) {
 	trace.global_instants = make([dynamic]Instant, big_global_allocator)
 	trace.parser = init_parser(size)
 	trace.error_message = ""
+	trace.progressive = false
+	trace.lod_min_time = 0
+	trace.follow = {}
+	init_search(trace)
+	init_calltree(trace)
+	trace.activity = {}
+
+	// progressive loads start drawing before finish_loading, so we need colors up front
+	generate_color_choices(trace)
 
 	// deliberately setting the first elem to 0, to simplify string interactions
 	non_zero_append_elem(&trace.string_block, 0)
@@ -389,12 +525,16 @@ init_loading_state :: proc(trace: ^Trace, size: u64, name: string) {
 	post_loading = false
 
 	fmt.printf("Loading a %M config\n", size)
-	start_bench("parse config")
+	start_bench("parse config", zone = false)
 }
 
 file_type := FileType.Invalid
 finish_loading :: proc (trace: ^Trace) {
-	stop_bench("parse config")
+	stop_bench("parse config", zone = false)
+
+	self_trace_begin("finish_loading")
+	defer self_trace_end()
+
 	fmt.printf("Got %d events, %d instants\n", trace.event_count, trace.instant_count)
 
 	free_all(temp_allocator)
@@ -415,17 +555,36 @@ finish_loading :: proc (trace: ^Trace) {
 	free_all(temp_allocator)
 	free_all(scratch_allocator)
 
-	generate_color_choices(trace)
+	// the process and thread sort just shuffled everything under any ids we handed out mid-load
+	if trace.progressive {
+		selected_event = empty_event
+		pressed_event = empty_event
+		released_event = empty_event
+		trace.zoom_event = empty_event
+	}
 
 	start_bench("generate spatial partitions")
 	chunk_events(trace)
 	stop_bench("generate spatial partitions")
 
-	start_bench("generate self-time")
-	if file_type == .Json {
-		json_generate_selftimes(trace)
+	free_all(scratch_allocator)
+
+	// a followed file keeps growing, so we walk the trees instead, see follow.odin
+	if !trace.follow.active {
+		start_bench("generate activity summaries")
+		build_activity_summaries(trace)
+		stop_bench("generate activity summaries")
+
+		free_all(scratch_allocator)
+
+		start_bench("generate stat summaries")
+		build_stat_summaries(trace)
+		stop_bench("generate stat summaries")
 	}
-	stop_bench("generate self-time")
+
+	start_bench("generate name index")
+	build_name_indices(trace)
+	stop_bench("generate name index")
 
 	t = 0
 	frame_count = 0
@@ -440,6 +599,10 @@ finish_loading :: proc (trace: ^Trace) {
 	ingest_end_time := u64(get_time())
 	time_range := ingest_end_time - ingest_start_time
 	fmt.printf("runtime: %fs (%dms)\n", f32(time_range) / 1000, time_range)
+	print_arena_usage("small_global", &small_global_arena)
+	print_arena_usage("big_global", &big_global_arena)
+	print_arena_usage("scratch", &scratch_arena)
+	print_arena_usage("scratch2", &scratch2_arena)
 	return
 }
 
@@ -448,6 +611,9 @@ load_config_chunk :: proc "contextless" (chunk: []u8) {
 	context = wasmContext
 	defer free_all(context.temp_allocator)
 
+	self_trace_begin("load_config_chunk")
+	defer self_trace_end()
+
 	if first_chunk {
 		header_sz := size_of(spall.Manual_Header)
 		if len(chunk) < header_sz {
@@ -501,33 +667,6 @@ bound_duration :: proc(ev: $T, max_ts: i64) -> i64 {
 	return ev.duration == -1 ? (max_ts - ev.timestamp) : ev.duration
 }
 
-append_event :: proc(array: ^[dynamic]Event, arg: Event) {
-	if cap(array) < (len(array) + 1) {
-
-		capacity := max(2 * cap(array), 8)
-		a := (^runtime.Raw_Dynamic_Array)(array)
-
-		old_size  := a.cap * size_of(Event)
-		new_size  := capacity * size_of(Event)
-
-		allocator := a.allocator
-
-		new_data, err := allocator.procedure(
-			allocator.data, .Resize_Non_Zeroed, new_size, align_of(Event),
-			a.data, old_size)
-
-		a.data = raw_data(new_data)
-		a.cap = capacity
-	}
-
-	if (cap(array) - len(array)) > 0 {
-		a := (^runtime.Raw_Dynamic_Array)(array)
-		data := ([^]Event)(a.data)
-		data[a.len] = arg
-		a.len += 1
-	}
-}
-
 setup_pid :: proc(trace: ^Trace, process_id: u32) -> i32 {
 	p_idx, ok := vh_find(&trace.process_map, process_id)
 	if !ok {
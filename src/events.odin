@@ -0,0 +1,387 @@
+package main
+
+import "base:runtime"
+
+// Events are stored column-wise per depth, so the render loop and the stats passes
+// only drag the fields they actually touch through the cache.
+//
+// Start times are u32 offsets from the first event in their BUCKET_SIZE leaf bucket,
+// and durations are plain u32 ticks. Anything that doesn't fit gets flagged and
+// spilled into a small sorted side-table. Args are sparse, most events don't have any.
+// Self-time isn't stored at all, it's derived from the next depth down when needed.
+//
+// The dense columns are segmented, so growing them never copies (and never leaves a dead
+// copy behind in the bump arena). Only the first segment grows by doubling, so tiny
+// depths don't each pin a full segment.
+
+WIDE_START    :: max(u32)
+NO_DURATION   :: max(u32)     // begin that never got an end, duration of -1
+WIDE_DURATION :: max(u32) - 1
+
+COLUMN_SEGMENT_SHIFT :: 12
+COLUMN_SEGMENT_SIZE  :: 1 << COLUMN_SEGMENT_SHIFT
+COLUMN_SEGMENT_MASK  :: COLUMN_SEGMENT_SIZE - 1
+
+init_column :: proc($T: typeid, reserve := 0) -> Column(T) {
+	c := Column(T){
+		segments = make([dynamic][^]T, big_global_allocator),
+	}
+
+	// presized columns get their whole first segment in one go
+	if reserve > 0 {
+		first_cap := min(reserve, COLUMN_SEGMENT_SIZE)
+		first := make([]T, first_cap, big_global_allocator)
+		append_column(&c.segments, raw_data(first))
+		c.first_cap = first_cap
+	}
+	return c
+}
+
+column_get :: #force_inline proc(c: ^Column($T), idx: int) -> T #no_bounds_check {
+	return c.segments[idx >> COLUMN_SEGMENT_SHIFT][idx & COLUMN_SEGMENT_MASK]
+}
+
+column_set :: #force_inline proc(c: ^Column($T), idx: int, val: T) #no_bounds_check {
+	c.segments[idx >> COLUMN_SEGMENT_SHIFT][idx & COLUMN_SEGMENT_MASK] = val
+}
+
+column_push :: proc(c: ^Column($T), val: T) #no_bounds_check {
+	idx := c.len
+	if idx < COLUMN_SEGMENT_SIZE {
+		if idx == c.first_cap {
+			new_cap := min(max(2 * c.first_cap, 8), COLUMN_SEGMENT_SIZE)
+			old_data: rawptr = len(c.segments) > 0 ? c.segments[0] : nil
+
+			allocator := big_global_allocator
+			first, _ := allocator.procedure(
+				allocator.data, .Resize_Non_Zeroed, new_cap * size_of(T), align_of(T),
+				old_data, c.first_cap * size_of(T))
+
+			if len(c.segments) > 0 {
+				c.segments[0] = ([^]T)(raw_data(first))
+			} else {
+				append_column(&c.segments, ([^]T)(raw_data(first)))
+			}
+			c.first_cap = new_cap
+		}
+	} else if idx & COLUMN_SEGMENT_MASK == 0 {
+		segment := make([]T, COLUMN_SEGMENT_SIZE, big_global_allocator)
+		append_column(&c.segments, raw_data(segment))
+	}
+
+	c.segments[idx >> COLUMN_SEGMENT_SHIFT][idx & COLUMN_SEGMENT_MASK] = val
+	c.len += 1
+}
+
+column_mem_usage :: proc(c: ^Column($T)) -> int {
+	total := size_of([^]T) * cap(c.segments)
+	if len(c.segments) > 0 {
+		total += size_of(T) * (c.first_cap + ((len(c.segments) - 1) * COLUMN_SEGMENT_SIZE))
+	}
+	return total
+}
+
+init_depth :: proc(reserve := 0) -> Depth {
+	bucket_reserve := i_round_up(reserve, BUCKET_SIZE) / BUCKET_SIZE
+	return Depth{
+		names         = init_column(u32, reserve),
+		starts        = init_column(u32, reserve),
+		durations     = init_column(u32, reserve),
+		bucket_starts = init_column(i64, bucket_reserve),
+		args           = make([dynamic]ArgEntry, big_global_allocator),
+		wide_starts    = make([dynamic]WideEntry, big_global_allocator),
+		wide_durations = make([dynamic]WideEntry, big_global_allocator),
+		selected_range = -1,
+	}
+}
+
+depth_len :: #force_inline proc(depth: ^Depth) -> int {
+	return depth.names.len
+}
+
+depth_mem_usage :: proc(depth: ^Depth) -> int {
+	total := 0
+	total += column_mem_usage(&depth.names)
+	total += column_mem_usage(&depth.starts)
+	total += column_mem_usage(&depth.durations)
+	total += column_mem_usage(&depth.bucket_starts)
+	total += size_of(ArgEntry)  * cap(depth.args)
+	total += size_of(WideEntry) * cap(depth.wide_starts)
+	total += size_of(WideEntry) * cap(depth.wide_durations)
+	return total
+}
+
+// events must be pushed in start order, the bucket offsets depend on it
+depth_push_event :: proc(depth: ^Depth, name, args: u32, timestamp, duration: i64) -> i32 {
+	idx := depth_len(depth)
+	if idx % BUCKET_SIZE == 0 {
+		column_push(&depth.bucket_starts, timestamp)
+	}
+
+	column_push(&depth.names, name)
+
+	offset := timestamp - column_get(&depth.bucket_starts, idx / BUCKET_SIZE)
+	if offset >= 0 && offset < i64(WIDE_START) {
+		column_push(&depth.starts, u32(offset))
+	} else {
+		column_push(&depth.starts, WIDE_START)
+		wide_set(&depth.wide_starts, i32(idx), timestamp)
+	}
+
+	column_push(&depth.durations, NO_DURATION)
+	if duration != -1 {
+		set_event_duration(depth, idx, duration)
+	}
+
+	if args != 0 {
+		append_column(&depth.args, ArgEntry{i32(idx), args})
+	}
+
+	return i32(idx)
+}
+
+event_start :: #force_inline proc(depth: ^Depth, idx: int) -> i64 #no_bounds_check {
+	offset := column_get(&depth.starts, idx)
+	if offset == WIDE_START {
+		return wide_get(depth.wide_starts[:], i32(idx))
+	}
+	return column_get(&depth.bucket_starts, idx / BUCKET_SIZE) + i64(offset)
+}
+
+event_duration :: #force_inline proc(depth: ^Depth, idx: int) -> i64 #no_bounds_check {
+	duration := column_get(&depth.durations, idx)
+	if duration == NO_DURATION {
+		return -1
+	} else if duration == WIDE_DURATION {
+		return wide_get(depth.wide_durations[:], i32(idx))
+	}
+	return i64(duration)
+}
+
+set_event_duration :: proc(depth: ^Depth, idx: int, duration: i64) {
+	if duration == -1 {
+		column_set(&depth.durations, idx, NO_DURATION)
+	} else if duration >= 0 && duration < i64(WIDE_DURATION) {
+		column_set(&depth.durations, idx, u32(duration))
+	} else {
+		column_set(&depth.durations, idx, WIDE_DURATION)
+		wide_set(&depth.wide_durations, i32(idx), duration)
+	}
+}
+
+event_name :: #force_inline proc(depth: ^Depth, idx: int) -> u32 #no_bounds_check {
+	return column_get(&depth.names, idx)
+}
+
+event_args :: proc(depth: ^Depth, idx: int) -> u32 {
+	low := 0
+	high := len(depth.args) - 1
+	for low <= high {
+		mid := (low + high) / 2
+		entry := depth.args[mid]
+		if entry.idx == i32(idx) {
+			return entry.args
+		} else if entry.idx < i32(idx) {
+			low = mid + 1
+		} else {
+			high = mid - 1
+		}
+	}
+	return 0
+}
+
+// Everything but args and self-time, which both cost a lookup
+depth_event :: #force_inline proc(depth: ^Depth, idx: int) -> Event {
+	return Event{
+		name      = event_name(depth, idx),
+		timestamp = event_start(depth, idx),
+		duration  = event_duration(depth, idx),
+	}
+}
+
+wide_get :: proc(entries: []WideEntry, idx: i32) -> i64 {
+	low := 0
+	high := len(entries) - 1
+	for low <= high {
+		mid := (low + high) / 2
+		entry := entries[mid]
+		if entry.idx == idx {
+			return entry.val
+		} else if entry.idx < idx {
+			low = mid + 1
+		} else {
+			high = mid - 1
+		}
+	}
+
+	push_fatal(SpallError.Bug)
+}
+
+// entries almost always land in idx order, so the fast path is an append
+wide_set :: proc(entries: ^[dynamic]WideEntry, idx: i32, val: i64) {
+	count := len(entries)
+	if count == 0 || entries[count - 1].idx < idx {
+		append_column(entries, WideEntry{idx, val})
+		return
+	}
+
+	low := 0
+	high := count
+	for low < high {
+		mid := (low + high) / 2
+		if entries[mid].idx < idx {
+			low = mid + 1
+		} else {
+			high = mid
+		}
+	}
+
+	if entries[low].idx == idx {
+		entries[low].val = val
+		return
+	}
+	inject_at(entries, low, WideEntry{idx, val})
+}
+
+// Self-time for a single event, using the LOD weights of the depth below
+// so we don't have to walk every child
+get_self_time :: proc(trace: ^Trace, thread: ^Thread, d_idx, e_idx: int) -> i64 {
+	depth := &thread.depths[d_idx]
+	ev := depth_event(depth, e_idx)
+	duration := bound_duration(ev, thread.max_time)
+	if d_idx + 1 >= len(thread.depths) {
+		return duration
+	}
+
+	child_depth := &thread.depths[d_idx + 1]
+	tree := child_depth.tree
+	if len(tree) == 0 {
+		return duration
+	}
+
+	tree_stack := [128]int{}
+	stack_len := 0
+
+	start_time := ev.timestamp - trace.total_min_time
+	end_time := start_time + duration
+
+	child_time : i64 = 0
+	tree_stack[0] = 0; stack_len += 1
+	for stack_len > 0 {
+		stack_len -= 1
+
+		tree_idx := tree_stack[stack_len]
+		cur_node := tree[tree_idx]
+
+		if end_time < cur_node.start_time || start_time > cur_node.end_time {
+			continue
+		}
+
+		if cur_node.start_time >= start_time && cur_node.end_time <= end_time {
+			child_time += cur_node.weight
+			continue
+		}
+
+		child_count := get_child_count(child_depth, tree_idx)
+		if child_count <= 0 {
+			event_count := get_event_count(child_depth, tree_idx)
+			event_start_idx := get_event_start_idx(child_depth, tree_idx)
+			event_end_idx := event_start_idx + event_count
+			if event_count > BUCKET_SIZE {
+				event_start_idx = first_event_ending_after(trace, child_depth, thread.max_time, event_start_idx, event_end_idx, start_time)
+			}
+			scan_loop: for i in event_start_idx..<event_end_idx {
+				scan_ev := depth_event(child_depth, i)
+				scan_ev_start_time := scan_ev.timestamp - trace.total_min_time
+				if scan_ev_start_time < start_time {
+					continue
+				}
+
+				scan_ev_duration := bound_duration(scan_ev, thread.max_time)
+				if scan_ev_start_time + scan_ev_duration > end_time {
+					break scan_loop
+				}
+
+				child_time += scan_ev_duration
+			}
+			continue
+		}
+
+		for i := child_count; i > 0; i -= 1 {
+			tree_stack[stack_len] = get_left_child(tree_idx) + i - 1; stack_len += 1
+		}
+	}
+
+	return max(duration - child_time, 0)
+}
+
+// Self-times for events [start, start + len(out)).
+// Children sit entirely inside their parent, and both depths are sorted by start time,
+// so a single forward sweep hands every child to its parent. child_idx carries the sweep
+// between calls, so a depth can be done a block at a time.
+sweep_self_times :: proc(trace: ^Trace, thread: ^Thread, d_idx, start: int, out: []i64, child_idx: ^int) {
+	depth := &thread.depths[d_idx]
+	if d_idx + 1 >= len(thread.depths) {
+		for i in 0..<len(out) {
+			out[i] = bound_duration(depth_event(depth, start + i), thread.max_time)
+		}
+		return
+	}
+
+	child_depth := &thread.depths[d_idx + 1]
+	child_count := depth_len(child_depth)
+
+	c_idx := child_idx^
+	for i in 0..<len(out) {
+		ev := depth_event(depth, start + i)
+		duration := bound_duration(ev, thread.max_time)
+		ev_end := ev.timestamp + duration
+
+		child_time : i64 = 0
+		child_loop: for ; c_idx < child_count; c_idx += 1 {
+			child := depth_event(child_depth, c_idx)
+			if child.timestamp < ev.timestamp {
+				continue
+			}
+
+			// anything that doesn't end inside this parent (like a child starting right at its end)
+			// belongs to a later one, so leave it for them
+			child_duration := bound_duration(child, thread.max_time)
+			if child.timestamp + child_duration > ev_end {
+				break child_loop
+			}
+
+			child_time += child_duration
+		}
+
+		out[i] = max(duration - child_time, 0)
+	}
+	child_idx^ = c_idx
+}
+
+append_column :: proc(array: ^[dynamic]$T, arg: T) {
+	if cap(array) < (len(array) + 1) {
+
+		capacity := max(2 * cap(array), 8)
+		a := (^runtime.Raw_Dynamic_Array)(array)
+
+		old_size  := a.cap * size_of(T)
+		new_size  := capacity * size_of(T)
+
+		allocator := a.allocator
+
+		new_data, err := allocator.procedure(
+			allocator.data, .Resize_Non_Zeroed, new_size, align_of(T),
+			a.data, old_size)
+
+		a.data = raw_data(new_data)
+		a.cap = capacity
+	}
+
+	if (cap(array) - len(array)) > 0 {
+		a := (^runtime.Raw_Dynamic_Array)(array)
+		data := ([^]T)(a.data)
+		data[a.len] = arg
+		a.len += 1
+	}
+}
@@ -0,0 +1,265 @@
+package main
+
+import "core:fmt"
+import "core:mem"
+import "formats:spall"
+
+// Follow mode
+//
+// Tails a v3 file that's still being written. The JS side polls for whatever got appended
+// and hands it over in load_follow_chunk; we hold on to any partial buffer block until the
+// rest of it shows up. The first batch of blocks goes through finish_loading like a normal
+// file, after that every batch is parsed straight into the depths it belongs to, and only
+// the threads that got new events have their LODs patched (or rebuilt, see lod_needs_rebuild).
+// Spans that haven't ended yet stay open, and keep growing with their thread.
+// A running search checks just the new events of patched depths, and re-probes rebuilt ones;
+// it only starts over when new names match the query, or every depth got rebuilt.
+//
+// The activity and stat summaries cover a fixed set of events, so a followed file never
+// gets them; the minimap walks the LOD trees and stats scan the events instead, a frame's
+// budget at a time. Rebuilds reuse each depth's tree and search buffers, so a long tail
+// only grows memory with the events themselves.
+// Processes and threads that show up after the first batch land at the bottom, unsorted.
+
+FollowState :: struct {
+	active:      bool,
+	started:     bool, // got through finish_loading
+	auto_scroll: bool,
+
+	// bytes we haven't parsed yet, starting at a block header
+	pending:    [dynamic]u8,
+	got_header: bool,
+	name_count: int,
+}
+
+// The pid/tid maps and begin stacks normally live in scratch and die in finish_loading,
+// following keeps loading after that, so they need to outlive it
+loader_allocator :: proc() -> mem.Allocator {
+	return _trace.follow.active ? big_global_allocator : scratch_allocator
+}
+
+@export
+start_following :: proc "contextless" (name: string) {
+	context = wasmContext
+	init_loading_state(&_trace, 0, name)
+
+	f := &_trace.follow
+	f.active = true
+	f.auto_scroll = true
+	f.pending = make([dynamic]u8, big_global_allocator)
+
+	_trace.process_map = vh_init(loader_allocator())
+
+	// there's no end to load up to, this just keeps the loading screen at 0%
+	_trace.parser.total_size = 1
+}
+
+@export
+load_follow_chunk :: proc "contextless" (chunk: []u8) {
+	context = wasmContext
+	defer free_all(context.temp_allocator)
+
+	self_trace_begin("load_follow_chunk")
+	defer self_trace_end()
+
+	// somebody opened a different file while this chunk was in flight
+	if !_trace.follow.active {
+		return
+	}
+
+	follow_ingest(&_trace, chunk)
+}
+
+follow_ingest :: proc(trace: ^Trace, chunk: []u8) {
+	f := &trace.follow
+	append(&f.pending, ..chunk)
+
+	pos := 0
+	data_len := len(f.pending)
+	if !f.got_header {
+		header_sz := size_of(spall.Manual_Header)
+		if data_len < header_sz {
+			return
+		}
+
+		hdr := (^spall.Manual_Header)(raw_data(f.pending))^
+		if hdr.magic != spall.MANUAL_MAGIC || hdr.version != 3 {
+			fmt.printf("Only v3 spall files can be followed, this one's version %d!\n", hdr.version)
+			push_fatal(SpallError.InvalidFileVersion)
+		}
+
+		trace.stamp_scale = hdr.timestamp_unit
+		file_type = .ManualStreamV2
+		f.got_header = true
+		pos = header_sz
+	}
+
+	// ms_v2_get_next_event wants 8 bytes to look at before it'll read anything,
+	// and the last event in the file can be a 3 byte thread name
+	non_zero_resize(&f.pending, data_len + size_of(u64))
+	zero_slice(f.pending[data_len:])
+
+	got_blocks := false
+	buf_header_sz := size_of(spall.Manual_Buffer_Header)
+	for data_len - pos >= buf_header_sz {
+		hdr := (^spall.Manual_Buffer_Header)(&f.pending[pos])^
+		if data_len - pos - buf_header_sz < int(hdr.size) {
+			break
+		}
+
+		follow_load_block(trace, f.pending[:], pos + buf_header_sz, &hdr)
+		pos += buf_header_sz + int(hdr.size)
+		got_blocks = true
+	}
+
+	// keep the partial block for next time, and drop the padding
+	leftover := data_len - pos
+	if pos > 0 {
+		copy(f.pending[:], f.pending[pos:data_len])
+	}
+	non_zero_resize(&f.pending, leftover)
+
+	if !got_blocks {
+		return
+	}
+
+	if !f.started {
+		follow_start(trace)
+	} else {
+		follow_update(trace)
+	}
+}
+
+follow_load_block :: proc(trace: ^Trace, chunk: []u8, start: int, hdr: ^spall.Manual_Buffer_Header) {
+	p := &trace.parser
+	p.offset = 0
+	p.pos = i64(start)
+
+	p_idx := setup_pid(trace, hdr.pid)
+	t_idx := setup_tid(trace, p_idx, hdr.tid)
+	process := &trace.processes[p_idx]
+	thread := &process.threads[t_idx]
+	thread.touched = true
+
+	temp_ev := TempEvent{}
+	block_end := p.pos + i64(hdr.size)
+	for p.pos < block_end {
+		mem.zero(&temp_ev, size_of(TempEvent))
+		state := ms_v2_get_next_event(trace, chunk, &temp_ev)
+
+		#partial switch state {
+		case .PartialRead:
+			fmt.printf("Invalid trailing data? dropping from [%d -> %d] (%d bytes)\n", p.pos, block_end, block_end - p.pos)
+			return
+		case .Failure:
+			fmt.printf("failed to get next event!\n")
+			push_fatal(SpallError.InvalidFile)
+		}
+
+		ms_v2_apply_event(trace, hdr, process, thread, &temp_ev)
+	}
+}
+
+// The first batch loads like a whole file would, minus the cleanup of unfinished events
+follow_start :: proc(trace: ^Trace) {
+	finish_loading(trace)
+
+	// the process and thread sort just moved everything out from under the pid/tid maps
+	trace.process_map = vh_init(big_global_allocator)
+	for &proc_v, p_idx in trace.processes {
+		vh_insert(&trace.process_map, proc_v.id, i32(p_idx))
+
+		proc_v.thread_map = vh_init(big_global_allocator)
+		for &tm, t_idx in proc_v.threads {
+			vh_insert(&proc_v.thread_map, tm.id, i32(t_idx))
+			tm.touched = false
+		}
+	}
+
+	trace.follow.name_count = len(trace.intern.entries)
+	trace.follow.started = true
+}
+
+follow_update :: proc(trace: ^Trace) {
+	self_trace_begin("follow_update")
+	defer self_trace_end()
+
+	render_gen += 1
+
+	// every node is stored relative to total_min_time, if that moved everything's stale
+	min_time_moved := trace.lod_min_time != trace.total_min_time
+	trace.lod_min_time = trace.total_min_time
+
+	searching := search_active(trace)
+	stale := make([dynamic]SearchDepth, context.temp_allocator)
+	for &proc_v, p_idx in trace.processes {
+		for &tm, t_idx in proc_v.threads {
+			if !tm.touched && !min_time_moved {
+				continue
+			}
+			tm.touched = false
+
+			for &depth, d_idx in tm.depths {
+				if min_time_moved || lod_needs_rebuild(&depth) {
+					// the rebuild throws out the tail, search_redo_depths takes care of the rest
+					if searching {
+						trace.search.hit_count -= u64(depth.tail_hits)
+					}
+
+					build_depth_lod(trace, &tm, &depth)
+					build_depth_name_index(&depth)
+
+					depth.search_stale = true
+					append(&stale, SearchDepth{i32(p_idx), i32(t_idx), i32(d_idx)})
+				} else {
+					patch_lod_spine(trace, &tm, &depth)
+					if searching && search_probed(trace, p_idx, t_idx, d_idx) {
+						search_mark_tail(trace, p_idx, t_idx, d_idx)
+					}
+				}
+			}
+		}
+	}
+
+	// new names might match the query, that needs the whole search redone
+	new_match := false
+	query := search_query(trace)
+	if len(query) > 0 {
+		for entry in trace.intern.entries[trace.follow.name_count:] {
+			if contains_fold(in_getstr(&trace.string_block, entry), query) {
+				new_match = true
+				break
+			}
+		}
+	}
+
+	if new_match || (searching && min_time_moved) {
+		run_search(trace)
+	} else if searching && len(stale) > 0 {
+		search_redo_depths(trace, stale[:])
+	}
+
+	for ref in stale {
+		trace.processes[ref.pid].threads[ref.tid].depths[ref.did].search_stale = false
+	}
+	trace.follow.name_count = len(trace.intern.entries)
+}
+
+// Keeps the end of the file in view while it grows, until you grab the graph
+follow_frame :: proc(trace: ^Trace, ui_state: ^UIState) {
+	f := &trace.follow
+	if !f.active || !f.started {
+		return
+	}
+
+	if did_pan && is_mouse_down && !shift_down && pt_in_rect(clicked_pos, ui_state.padded_flamegraph_rect) {
+		f.auto_scroll = false
+	}
+
+	if f.auto_scroll {
+		// same right edge reset_flamegraph_camera leaves
+		duration := f64(trace.total_max_time - trace.total_min_time)
+		cam.target_pan_x = ui_state.full_flamegraph_rect.w - (2 * em) - (duration * cam.target_scale)
+		cam.vel.x = 0
+	}
+}
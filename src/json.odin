@@ -942,32 +942,73 @@ instant_rendersort_proc :: proc(a, b: Instant) -> bool {
 }
 
 // duration bounding is important when sorting, we don't want to accidentally a -1 somewhere
-insertion_sort_events :: proc(events: []JSONEvent, max_time: i64) {
-	event_buildsort :: proc(max_time: i64, a, b: JSONEvent) -> bool {
-		if a.timestamp == b.timestamp {
-			return bound_duration(a, max_time) > bound_duration(b, max_time)
-		}
-		return a.timestamp < b.timestamp
+json_event_less :: #force_inline proc(max_time: i64, a, b: JSONEvent) -> bool {
+	if a.timestamp == b.timestamp {
+		return bound_duration(a, max_time) > bound_duration(b, max_time)
 	}
+	return a.timestamp < b.timestamp
+}
 
+// Orders events by start ascending, then duration descending, so parents land before their children.
+// Merged multi-process traces can be arbitrarily shuffled, so this is a pair of radix passes
+// (duration, then start) rather than a comparison sort, and stays linear no matter the input.
+sort_json_events :: proc(events: []JSONEvent, max_time: i64) {
+	in_order := true
 	for i := 1; i < len(events); i += 1 {
-		j := i - 1
+		if json_event_less(max_time, events[i], events[i-1]) {
+			in_order = false
+			break
+		}
+	}
+	if in_order {
+		return
+	}
+
+	allocator := radix_scratch_allocator(len(events))
+	items := make([]RadixItem, len(events), allocator)
+	tmp   := make([]RadixItem, len(events), allocator)
+	for ev, i in events {
+		items[i] = RadixItem{key = ~radix_key_i64(bound_duration(ev, max_time)), idx = u32(i)}
+	}
+	sorted := radix_sort_items(items, tmp)
+
+	spare := raw_data(sorted) == raw_data(items) ? tmp : items
+	for &item in sorted {
+		item.key = radix_key_i64(events[item.idx].timestamp)
+	}
+	sorted = radix_sort_items(sorted, spare)
+
+	permute_by_items(events, sorted)
+}
 
-		temp := events[i]
-		for ; j >= 0 && event_buildsort(max_time, temp, events[j]); {
-			events[j+1] = events[j]
-			j -= 1
+sort_instants :: proc(instants: []Instant) {
+	in_order := true
+	for i := 1; i < len(instants); i += 1 {
+		if instant_rendersort_proc(instants[i], instants[i-1]) {
+			in_order = false
+			break
 		}
+	}
+	if in_order {
+		return
+	}
 
-		events[j+1] = temp
+	allocator := radix_scratch_allocator(len(instants))
+	items := make([]RadixItem, len(instants), allocator)
+	tmp   := make([]RadixItem, len(instants), allocator)
+	for instant, i in instants {
+		items[i] = RadixItem{key = radix_key_i64(instant.timestamp), idx = u32(i)}
 	}
+
+	sorted := radix_sort_items(items, tmp)
+	permute_by_items(instants, sorted)
 }
 
 json_process_events :: proc(trace: ^Trace) {
 	ev_stack: Stack(i32)
 	stack_init(&ev_stack, context.temp_allocator)
 
-	slice.sort_by(trace.global_instants[:], instant_rendersort_proc)
+	sort_instants(trace.global_instants[:])
 
 	for pe, _ in trace.process_map.entries {
 		proc_idx := pe.val
@@ -981,7 +1022,8 @@ json_process_events :: proc(trace: ^Trace) {
 				continue
 			}
 
-			insertion_sort_events(tm.json_events[:], tm.max_time)
+			free_all(scratch2_allocator)
+			sort_json_events(tm.json_events[:], tm.max_time)
 
 			free_all(scratch2_allocator)
 			depth_counts := make([dynamic]u32, 0, 64, scratch2_allocator)
@@ -1030,42 +1072,14 @@ json_process_events :: proc(trace: ^Trace) {
 				event.depth = u16(cur_depth)
 			}
 
-			depth_offsets := make([]u32, len(depth_counts), scratch2_allocator)
-			cur_offset : u32 = 0
-			for i := 0; i < len(depth_counts); i += 1 {
-				depth_offsets[i] = cur_offset
-				cur_offset += depth_counts[i]
+			for count in depth_counts {
+				non_zero_append(&tm.depths, init_depth(int(count)))
 			}
 
-			depth_counters := make([]u32, len(depth_counts), scratch2_allocator)
-			mem.zero_slice(depth_counters)
-
-			sorted_events := make([]Event, len(tm.json_events), big_global_allocator)
+			// json_events is in start order, so every depth gets its events in start order too
 			for event in tm.json_events {
-				depth := event.depth
-
-				sort_idx := depth_offsets[depth] + depth_counters[depth]
-
-				sorted_events[sort_idx] = Event{
-					name = event.name,
-					args = event.args,
-					timestamp = event.timestamp,
-					duration = event.duration,
-					self_time = event.self_time,
-				}
-
-				depth_counters[depth] += 1
-			}
-
-			ev_start : u32 = 0
-			for i := 0; i < len(depth_counts); i += 1 {
-				count := depth_counts[i]
-				temp_events := slice_to_dyn(sorted_events[ev_start:ev_start+count])
-				depth := Depth{
-					events = temp_events,
-				}
-				ev_start += count
-				non_zero_append(&tm.depths, depth)
+				depth := &tm.depths[event.depth]
+				depth_push_event(depth, event.name, event.args, event.timestamp, event.duration)
 			}
 		}
 	}
@@ -1074,79 +1088,3 @@ json_process_events :: proc(trace: ^Trace) {
 	return
 }
 
-json_generate_selftimes :: proc(trace: ^Trace) {
-	for &proc_v, p_idx in trace.processes {
-		for &tm, t_idx in proc_v.threads {
-
-			// skip the bottom rank, it's already set up correctly
-			if len(tm.depths) == 1 {
-				continue
-			}
-
-			for &depth, d_idx in tm.depths {
-				// skip the last depth
-				if d_idx == (len(tm.depths) - 1) {
-					continue
-				}
-
-				for &ev, e_idx in depth.events {
-					depth := &tm.depths[d_idx+1]
-					tree := &depth.tree
-
-					tree_stack := [128]int{}
-					stack_len := 0
-
-					start_time := ev.timestamp - trace.total_min_time
-					end_time := ev.timestamp + bound_duration(&ev, tm.max_time) - trace.total_min_time
-
-					child_time : i64 = 0
-					tree_stack[0] = 0; stack_len += 1
-					for stack_len > 0 {
-						stack_len -= 1
-
-						tree_idx := tree_stack[stack_len]
-						cur_node := tree[tree_idx]
-
-						if end_time < cur_node.start_time || start_time > cur_node.end_time {
-							continue
-						}
-
-						if cur_node.start_time >= start_time && cur_node.end_time <= end_time {
-							child_time += cur_node.weight
-							continue
-						}
-
-						child_count := get_child_count(depth, tree_idx)
-						if child_count <= 0 {
-							event_count := get_event_count(depth, tree_idx)
-							event_start_idx := get_event_start_idx(depth, tree_idx)
-							scan_arr := depth.events[event_start_idx:event_start_idx+event_count]
-							weight : i64 = 0
-							scan_loop: for &scan_ev in scan_arr {
-								scan_ev_start_time := scan_ev.timestamp - trace.total_min_time
-								if scan_ev_start_time < start_time {
-									continue
-								}
-
-								scan_ev_end_time := scan_ev.timestamp + bound_duration(&scan_ev, tm.max_time) - trace.total_min_time
-								if scan_ev_end_time > end_time {
-									break scan_loop
-								}
-
-								weight += bound_duration(&scan_ev, tm.max_time)
-							}
-							child_time += weight
-							continue
-						}
-
-						for i := child_count; i > 0; i -= 1 {
-							tree_stack[stack_len] = get_left_child(tree_idx) + i - 1; stack_len += 1
-						}
-					}
-
-					ev.self_time = bound_duration(&ev, tm.max_time) - child_time
-				}
-			}
-		}
-	}
-}
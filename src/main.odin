@@ -36,6 +36,16 @@ is_hovering    := false
 shift_down     := false
 ctrl_down      := false
 
+// keys and text that came in since the last frame
+KeyInput :: enum {
+	Backspace,
+	Return,
+	Escape,
+}
+pressed_keys: bit_set[KeyInput]
+typed_chars:  [32]rune
+typed_len:    int
+
 last_mouse_pos := Vec2{}
 mouse_pos      := Vec2{}
 clicked_pos    := Vec2{}
@@ -121,6 +131,9 @@ awake := true
 set_flamegraph_camera :: proc(trace: ^Trace, ui_state: ^UIState, start_ticks, duration_ticks: i64) {
 	cam.vel = Vec2{}
 
+	// we're going somewhere specific, don't get dragged back to the end of a followed file
+	trace.follow.auto_scroll = false
+
 	cam.current_scale = rescale(1.0, 0, f64(duration_ticks), 0, ui_state.full_flamegraph_rect.w)
 	cam.target_scale = cam.current_scale
 
@@ -206,6 +219,7 @@ frame :: proc "contextless" (width, height: f64, _dt: f64, current_time: f64) ->
 		was_mouse_down = false
 		mouse_up_now = false
 		released_event = {-1, -1, -1, -1}
+		pressed_keys = {}
 
 		ui_state.render_one_more = false
 		frame_count += 1
@@ -213,19 +227,25 @@ frame :: proc "contextless" (width, height: f64, _dt: f64, current_time: f64) ->
 		free_all(context.temp_allocator)
 	}
 
+	self_trace_frame_start()
+	self_trace_begin("frame")
+	defer self_trace_end()
+
 	rect_tooltip_rect = empty_event
 	rect_tooltip_pos = Vec2{}
 	rendered_rect_tooltip = false
 
 	if first_frame {
 		clicked_t = current_time
-		manual_load(default_config, default_config_name)
+		if !_trace.follow.active {
+			manual_load(default_config, default_config_name)
+		}
 		first_frame = false
 		return true
 	}
 
-	// render loading screen
-	if loading_config {
+	// render loading screen, unless we've got enough of the file to start drawing
+	if loading_config && !_trace.progressive {
 		pad_size : f64 = 4
 		chunk_size : f64 = 10
 
@@ -336,7 +356,10 @@ frame :: proc "contextless" (width, height: f64, _dt: f64, current_time: f64) ->
 	ui_state.padded_flamegraph_rect.h -= em
 
 	if post_loading {
-		reset_flamegraph_camera(&_trace, &ui_state)
+		// if the user's been looking at the file while it loaded, leave the camera where they put it
+		if loading_config || !_trace.progressive {
+			reset_flamegraph_camera(&_trace, &ui_state)
+		}
 		ui_state.multiselecting = false
 		lfc = 0
 		post_loading = false
@@ -348,30 +371,53 @@ frame :: proc "contextless" (width, height: f64, _dt: f64, current_time: f64) ->
 		did_pan = false
 		pressed_event = {-1, -1, -1, -1} // so no stale events are tracked
 	}
+	process_search_input(&_trace, &ui_state)
+	follow_frame(&_trace, &ui_state)
+	self_trace_begin("process_inputs")
 	start_time, end_time, pan_delta := process_inputs(&_trace, dt, &ui_state)
+	self_trace_end()
 
 	clicked_on_rect = false
 	rect_count = 0
 	bucket_count = 0
+	rect_cache_hits = 0
+	rect_cache_shifts = 0
+	rect_cache_misses = 0
 
 	// Init GL / Text canvases
 	canvas_clear()
 	gl_init_frame(bg_color2)
 	gl_rects = make([dynamic]DrawRect, 0, int(width / 2), temp_allocator)
 
+	self_trace_begin("draw_flamegraphs")
 	draw_flamegraphs(&_trace, start_time, end_time, &ui_state)
+	self_trace_end()
+	if loading_config {
+		draw_load_frontier(&_trace, &ui_state)
+	}
 
+	self_trace_begin("draw_minimap")
 	draw_minimap(&_trace, &ui_state)
+	self_trace_end()
+	self_trace_begin("draw_topbars")
 	draw_topbars(&_trace, start_time, end_time, &ui_state)
+	self_trace_end()
 
 	// draw sidelines
 	draw_line(Vec2{ui_state.side_pad, header_height + timebar_height},       Vec2{ui_state.side_pad, ui_state.info_pane_rect.y}, 1, line_color)
 	draw_line(Vec2{ui_state.minimap_rect.x, header_height + timebar_height}, Vec2{ui_state.minimap_rect.x, ui_state.info_pane_rect.y}, 1, line_color)
 
 	process_multiselect(&_trace, pan_delta, dt, &ui_state)
+	self_trace_begin("process_stats")
 	process_stats(&_trace, &ui_state)
+	self_trace_end()
+	self_trace_begin("process_calltree")
+	process_calltree(&_trace, &ui_state)
+	self_trace_end()
 
+	self_trace_begin("draw_stats")
 	draw_stats(&_trace, &ui_state)
+	self_trace_end()
 	stats_just_started = false
 	if resort_stats {
 		sort_stats(&_trace)
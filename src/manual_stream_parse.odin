@@ -104,6 +104,7 @@ ms_v1_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 				last_read = p.pos
 			}
 
+			progressive_build_lods(trace)
 			p.offset = p.pos
 			get_chunk(f64(p.pos), f64(CHUNK_SIZE))
 			return
@@ -117,7 +118,6 @@ ms_v1_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 			ev.name = temp_ev.name
 			ev.args = temp_ev.args
 			ev.duration = -1
-			ev.self_time = 0 
 			ev.timestamp = temp_ev.timestamp
 
 			p_idx, t_idx, e_idx := ms_v1_bin_push_event(trace, temp_ev.process_id, temp_ev.thread_id, &ev)
@@ -144,20 +144,11 @@ ms_v1_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 				thread.current_depth -= 1
 
 				depth := &thread.depths[thread.current_depth]
-				jev := &depth.events[jev_data.idx]
-				jev.duration = temp_ev.timestamp - jev.timestamp
-				jev.self_time = jev.duration - jev.self_time
-				thread.max_time = max(thread.max_time, jev.timestamp + jev.duration)
-				trace.total_max_time = max(trace.total_max_time, jev.timestamp + jev.duration)
-
-				if thread.bande_q.len > 0 {
-					parent_depth := &thread.depths[thread.current_depth - 1]
-					parent_ev := stack_peek_back(&thread.bande_q)
-
-					pev := &parent_depth.events[parent_ev.idx]
-
-					pev.self_time += jev.duration
-				}
+				jev_start := event_start(depth, int(jev_data.idx))
+				jev_duration := temp_ev.timestamp - jev_start
+				set_event_duration(depth, int(jev_data.idx), jev_duration)
+				thread.max_time = max(thread.max_time, jev_start + jev_duration)
+				trace.total_max_time = max(trace.total_max_time, jev_start + jev_duration)
 			} else {
 				fmt.printf("Got unexpected end event! [pid: %d, tid: %d, ts: %v]\n", temp_ev.process_id, temp_ev.thread_id, temp_ev.timestamp)
 			}
@@ -171,23 +162,10 @@ ms_v1_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 				ev_data := stack_pop_back(&thread.bande_q)
 
 				depth := &thread.depths[ev_data.depth]
-				jev := &depth.events[ev_data.idx]
-
-				thread.max_time = max(thread.max_time, jev.timestamp)
-				trace.total_max_time = max(trace.total_max_time, jev.timestamp)
-
-				duration := bound_duration(jev, thread.max_time)
-				jev.self_time = duration - jev.self_time
-				jev.self_time = max(jev.self_time, 0)
+				jev_start := event_start(depth, int(ev_data.idx))
 
-				if thread.bande_q.len > 0 {
-					parent_depth := &thread.depths[ev_data.depth - 1]
-					parent_ev := stack_peek_back(&thread.bande_q)
-
-					pev := &parent_depth.events[parent_ev.idx]
-					pev.self_time += duration
-					pev.self_time = max(pev.self_time, 0)
-				}
+				thread.max_time = max(thread.max_time, jev_start)
+				trace.total_max_time = max(trace.total_max_time, jev_start)
 			}
 		}
 	}
@@ -217,17 +195,14 @@ ms_v1_bin_push_event :: proc(trace: ^Trace, process_id, thread_id: u32, event: ^
 	trace.total_max_time = max(trace.total_max_time, event.timestamp + event.duration)
 
 	if int(t.current_depth) >= len(t.depths) {
-		depth := Depth{
-			events = make([dynamic]Event, big_global_allocator),
-		}
-		non_zero_append(&t.depths, depth)
+		non_zero_append(&t.depths, init_depth())
 	}
 
 	depth := &t.depths[t.current_depth]
 	t.current_depth += 1
-	append_event(&depth.events, event^)
+	e_idx := depth_push_event(depth, event.name, event.args, event.timestamp, event.duration)
 
-	return p_idx, t_idx, i32(len(depth.events)-1)
+	return p_idx, t_idx, e_idx
 }
 
 ms_v1_bin_process_events :: proc(trace: ^Trace) {
@@ -343,7 +318,6 @@ ms_v2_get_next_event :: proc(trace: ^Trace, chunk: []u8, temp_ev: ^TempEvent) ->
 ms_v2_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 	p := &trace.parser
 	temp_ev := TempEvent{}
-	ev := Event{}
 	hdr := spall.Manual_Buffer_Header{}
 
 	full_chunk := chunk
@@ -359,6 +333,7 @@ ms_v2_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 				last_read = p.pos
 			}
 
+			progressive_build_lods(trace)
 			p.offset = p.pos
 			get_chunk(f64(p.pos), f64(CHUNK_SIZE))
 			return
@@ -386,6 +361,7 @@ ms_v2_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 					last_read = p.pos
 				}
 
+				progressive_build_lods(trace)
 				p.offset = p.pos
 				get_chunk(f64(p.pos), f64(CHUNK_SIZE))
 				return
@@ -394,80 +370,7 @@ ms_v2_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 				push_fatal(SpallError.InvalidFile)
 			}
 
-			#partial switch temp_ev.type {
-			case .Begin:
-				ev.name = temp_ev.name
-				ev.args = temp_ev.args
-				ev.duration = -1
-				ev.self_time = 0 
-				ev.timestamp = max(i64(temp_ev.timestamp), thread.zero_patchup)
-
-				if thread.max_time > ev.timestamp {
-					fmt.printf("Woah, time-travel? You just had a begin event that started before a previous one; [pid: %d, tid: %d, name: %s]\n", 
-						hdr.pid, hdr.tid, in_getstr(&trace.string_block, ev.name))
-					push_fatal(SpallError.InvalidFile)
-				}
-
-				process.min_time = min(process.min_time, ev.timestamp)
-				thread.min_time = min(thread.min_time, ev.timestamp)
-				thread.max_time = ev.timestamp
-
-				trace.total_min_time = min(trace.total_min_time, ev.timestamp)
-				trace.total_max_time = max(trace.total_max_time, ev.timestamp)
-
-				if int(thread.current_depth) >= len(thread.depths) {
-					depth := Depth{
-						events = make([dynamic]Event, big_global_allocator),
-					}
-					non_zero_append(&thread.depths, depth)
-				}
-
-				depth := &thread.depths[thread.current_depth]
-				thread.current_depth += 1
-				append_event(&depth.events, ev)
-
-				e_idx := i32(len(depth.events)-1)
-				stack_push_back(&thread.bande_q, EVData{idx = e_idx, depth = thread.current_depth - 1, self_time = 0})
-
-				trace.event_count += 1
-			case .End:
-				temp_ev.timestamp = max(i64(temp_ev.timestamp), thread.zero_patchup)
-				if thread.bande_q.len > 0 {
-					jev_data := stack_pop_back(&thread.bande_q)
-					thread.current_depth -= 1
-
-					depth := &thread.depths[thread.current_depth]
-					jev := &depth.events[jev_data.idx]
-					jev.duration = i64(temp_ev.timestamp) - jev.timestamp
-					if jev.duration == 0 {
-						thread.zero_patchup = i64(temp_ev.timestamp)
-						thread.zero_patchup += 1
-						jev.duration = 1
-					}
-
-					jev.self_time = jev.duration - jev.self_time
-					thread.max_time = max(thread.max_time, jev.timestamp + jev.duration)
-					trace.total_max_time = max(trace.total_max_time, jev.timestamp + jev.duration)
-
-					if thread.bande_q.len > 0 {
-						parent_depth := &thread.depths[thread.current_depth - 1]
-						parent_ev := stack_peek_back(&thread.bande_q)
-
-						pev := &parent_depth.events[parent_ev.idx]
-
-						pev.self_time += jev.duration
-					}
-				} else {
-					fmt.printf("Got unexpected end event! [pid: %d, tid: %d, ts: %f]\n", temp_ev.process_id, temp_ev.thread_id, temp_ev.timestamp)
-				}
-			case .SetName:
-				#partial switch temp_ev.scope {
-				case .Process:
-					process.name = temp_ev.name
-				case .Thread:
-					thread.name = temp_ev.name
-				}
-			}
+			ms_v2_apply_event(trace, &hdr, process, thread, &temp_ev)
 		}
 	}
 
@@ -478,23 +381,10 @@ ms_v2_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 				ev_data := stack_pop_back(&thread.bande_q)
 
 				depth := &thread.depths[ev_data.depth]
-				jev := &depth.events[ev_data.idx]
-
-				thread.max_time = max(thread.max_time, jev.timestamp)
-				trace.total_max_time = max(trace.total_max_time, jev.timestamp)
-
-				duration := bound_duration(jev, thread.max_time)
-				jev.self_time = duration - jev.self_time
-				jev.self_time = max(jev.self_time, 0)
+				jev_start := event_start(depth, int(ev_data.idx))
 
-				if thread.bande_q.len > 0 {
-					parent_depth := &thread.depths[ev_data.depth - 1]
-					parent_ev := stack_peek_back(&thread.bande_q)
-
-					pev := &parent_depth.events[parent_ev.idx]
-					pev.self_time += duration
-					pev.self_time = max(pev.self_time, 0)
-				}
+				thread.max_time = max(thread.max_time, jev_start)
+				trace.total_max_time = max(trace.total_max_time, jev_start)
 			}
 		}
 	}
@@ -502,3 +392,69 @@ ms_v2_load_binary_chunk :: proc(trace: ^Trace, chunk: []u8) {
 	finish_loading(trace)
 	return
 }
+
+// Shared between the file loader and follow mode, which hands it one block at a time
+ms_v2_apply_event :: proc(trace: ^Trace, hdr: ^spall.Manual_Buffer_Header, process: ^Process, thread: ^Thread, temp_ev: ^TempEvent) {
+	ev := Event{}
+
+	#partial switch temp_ev.type {
+	case .Begin:
+		ev.name = temp_ev.name
+		ev.args = temp_ev.args
+		ev.duration = -1
+		ev.timestamp = max(i64(temp_ev.timestamp), thread.zero_patchup)
+
+		if thread.max_time > ev.timestamp {
+			fmt.printf("Woah, time-travel? You just had a begin event that started before a previous one; [pid: %d, tid: %d, name: %s]\n", 
+				hdr.pid, hdr.tid, in_getstr(&trace.string_block, ev.name))
+			push_fatal(SpallError.InvalidFile)
+		}
+
+		process.min_time = min(process.min_time, ev.timestamp)
+		thread.min_time = min(thread.min_time, ev.timestamp)
+		thread.max_time = ev.timestamp
+
+		trace.total_min_time = min(trace.total_min_time, ev.timestamp)
+		trace.total_max_time = max(trace.total_max_time, ev.timestamp)
+
+		if int(thread.current_depth) >= len(thread.depths) {
+			non_zero_append(&thread.depths, init_depth())
+		}
+
+		depth := &thread.depths[thread.current_depth]
+		thread.current_depth += 1
+		e_idx := depth_push_event(depth, ev.name, ev.args, ev.timestamp, ev.duration)
+
+		stack_push_back(&thread.bande_q, EVData{idx = e_idx, depth = thread.current_depth - 1, self_time = 0})
+
+		trace.event_count += 1
+	case .End:
+		temp_ev.timestamp = max(i64(temp_ev.timestamp), thread.zero_patchup)
+		if thread.bande_q.len > 0 {
+			jev_data := stack_pop_back(&thread.bande_q)
+			thread.current_depth -= 1
+
+			depth := &thread.depths[thread.current_depth]
+			jev_start := event_start(depth, int(jev_data.idx))
+			jev_duration := i64(temp_ev.timestamp) - jev_start
+			if jev_duration == 0 {
+				thread.zero_patchup = i64(temp_ev.timestamp)
+				thread.zero_patchup += 1
+				jev_duration = 1
+			}
+			set_event_duration(depth, int(jev_data.idx), jev_duration)
+
+			thread.max_time = max(thread.max_time, jev_start + jev_duration)
+			trace.total_max_time = max(trace.total_max_time, jev_start + jev_duration)
+		} else {
+			fmt.printf("Got unexpected end event! [pid: %d, tid: %d, ts: %f]\n", temp_ev.process_id, temp_ev.thread_id, temp_ev.timestamp)
+		}
+	case .SetName:
+		#partial switch temp_ev.scope {
+		case .Process:
+			process.name = temp_ev.name
+		case .Thread:
+			thread.name = temp_ev.name
+		}
+	}
+}
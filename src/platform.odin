@@ -87,6 +87,20 @@ key_down :: proc "contextless" (key: i32) {
 	switch key {
 	case 1: // left-shift
 		shift_down = true
+	case 8:
+		pressed_keys += {.Backspace}
+	case 16:
+		pressed_keys += {.Return}
+	case 8192:
+		pressed_keys += {.Escape}
+	}
+}
+
+@export
+char_input :: proc "contextless" (c: i32) {
+	if typed_len < len(typed_chars) {
+		typed_chars[typed_len] = rune(c)
+		typed_len += 1
 	}
 }
 
@@ -168,11 +182,13 @@ foreign js {
 	get_session_storage :: proc(key: string) ---
 	set_session_storage :: proc(key: string, val: string) ---
 	get_time :: proc() -> f64 ---
+	get_precise_time :: proc() -> f64 ---
 	change_cursor :: proc(cursor: string) ---
 	get_system_color :: proc() -> bool ---
 
 	get_chunk :: proc(offset, size: f64) ---
 	open_file_dialog :: proc() ---
+	save_file :: proc(name: string, data: []u8) ---
 }
 
 // a bunch of silly platform wrappers, so I can jam in dpr scaling
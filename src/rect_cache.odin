@@ -0,0 +1,314 @@
+package main
+
+import "core:fmt"
+import "core:math"
+
+// Per-depth flamegraph rect cache
+//
+// Walking the LOD tree is most of the cost of a frame, and most frames (hovering, idling
+// with a selection, panning) draw exactly what the last one did. Each depth keeps the rects
+// its last walk produced, in scaled trace space, so they're still good after a pan. If the
+// scale and colors haven't changed we just replay them, walking only whatever edge a pan
+// uncovered. Anything that changes rect colors bumps render_gen.
+
+// how far the cached window can grow past the visible one before we start over
+RECT_CACHE_MAX_SPAN :: 4
+
+RectCacheItem :: struct {
+	x: f64, // scaled, relative to total_min_time, add cam.pan.x for screen space
+	w: f64,
+	color: BVec4,
+	e_idx: i32, // -1 for LOD summary rects
+}
+
+RectCache :: struct {
+	items: [dynamic]RectCacheItem,
+
+	scale: f64,
+	gen: u64,
+	start_time: i64,
+	end_time: i64,
+
+	multiselecting: bool,
+	range_start: i32,
+	range_end: i32,
+}
+
+render_gen : u64 = 1
+
+rect_cache_hits    := 0
+rect_cache_shifts  := 0
+rect_cache_misses  := 0
+rect_cache_total_hits  : u64 = 0
+rect_cache_total_draws : u64 = 0
+
+// The selected range for a depth, if it has one
+find_selected_range :: proc(trace: ^Trace, depth: ^Depth, p_idx, t_idx, d_idx: int) -> (Range, bool) {
+	r_idx := int(depth.selected_range)
+	if r_idx < 0 || r_idx >= len(trace.selected_ranges) {
+		return {}, false
+	}
+
+	range := trace.selected_ranges[r_idx]
+	if int(range.pid) != p_idx || int(range.tid) != t_idx || int(range.did) != d_idx {
+		return {}, false
+	}
+	return range, true
+}
+
+// Brings the depth's cache up to date for [start_time, end_time], walking as little of the tree as we can get away with
+update_rect_cache :: proc(trace: ^Trace, thread: ^Thread, depth: ^Depth, range: Range, has_range: bool, start_time, end_time: i64, multiselecting: bool) {
+	cache := &depth.rect_cache
+
+	range_start, range_end : i32 = -1, -1
+	if has_range {
+		range_start = range.start
+		range_end = range.end
+	}
+
+	same_frame := cache.scale == cam.current_scale && cache.gen == render_gen &&
+	              cache.multiselecting == multiselecting &&
+	              cache.range_start == range_start && cache.range_end == range_end
+
+	if same_frame && start_time >= cache.start_time && end_time <= cache.end_time {
+		rect_cache_hits += 1
+		return
+	}
+
+	window := end_time - start_time
+	union_span := max(end_time, cache.end_time) - min(start_time, cache.start_time)
+	if same_frame && union_span <= window * RECT_CACHE_MAX_SPAN {
+		rect_cache_shifts += 1
+
+		covered_start, covered_end := cache.start_time, cache.end_time
+		if start_time < covered_start {
+			walk_depth_rects(trace, thread, depth, range_start, range_end, multiselecting, start_time, covered_start, covered_start, covered_end)
+			cache.start_time = start_time
+		}
+		if end_time > covered_end {
+			walk_depth_rects(trace, thread, depth, range_start, range_end, multiselecting, covered_end, end_time, covered_start, covered_end)
+			cache.end_time = end_time
+		}
+		return
+	}
+
+	rect_cache_misses += 1
+	if cache.items == nil {
+		cache.items = make([dynamic]RectCacheItem, big_global_allocator)
+	}
+	non_zero_resize(&cache.items, 0)
+
+	cache.scale = cam.current_scale
+	cache.gen = render_gen
+	cache.multiselecting = multiselecting
+	cache.range_start = range_start
+	cache.range_end = range_end
+	cache.start_time = start_time
+	cache.end_time = end_time
+
+	walk_depth_rects(trace, thread, depth, range_start, range_end, multiselecting, start_time, end_time, max(i64), min(i64))
+}
+
+// Walks the tree for [start_time, end_time], skipping events and summary nodes that overlap
+// [covered_start, covered_end], since they're already in the cache
+walk_depth_rects :: proc(trace: ^Trace, thread: ^Thread, depth: ^Depth, range_start, range_end: i32, multiselecting: bool, start_time, end_time, covered_start, covered_end: i64) {
+	cache := &depth.rect_cache
+	tree := depth.tree
+
+	// If we blow this, we're in space
+	tree_stack := [128]int{}
+	stack_len := 0
+
+	// depths that showed up mid-load might not have a tree yet
+	if len(depth.tree) > 0 {
+		tree_stack[0] = 0; stack_len += 1
+	}
+	for stack_len > 0 {
+		stack_len -= 1
+
+		tree_idx := tree_stack[stack_len]
+		cur_node := &tree[tree_idx]
+
+		if cur_node.end_time < start_time || cur_node.start_time > end_time {
+			continue
+		}
+
+		time_range := f64(cur_node.end_time - cur_node.start_time)
+		range_width := time_range * cam.current_scale
+
+		// draw summary faketangle
+		min_width := 2.0
+		if (range_width / math.sqrt_f64(CHUNK_NARY_WIDTH)) < min_width {
+			// the walk that covered the old window came down the same path at the same scale
+			if cur_node.end_time >= covered_start && cur_node.start_time <= covered_end {
+				continue
+			}
+
+			rect_color := cur_node.avg_color
+			grey := greyscale(cur_node.avg_color)
+			if search_active(trace) && !node_has_hit(depth, tree_idx) {
+				rect_color = grey
+			}
+			if multiselecting {
+				ev_start, ev_end := get_event_range(depth, tree_idx)
+				if range_start == -1 || !range_in_range(ev_start, ev_end, int(range_start), int(range_end)) {
+					rect_color = grey
+				}
+			}
+
+			append(&cache.items, RectCacheItem{
+				x     = f64(cur_node.start_time) * cam.current_scale,
+				w     = min_width * math.sqrt_f64(CHUNK_NARY_WIDTH),
+				color = BVec4{u8(rect_color.x), u8(rect_color.y), u8(rect_color.z), 255},
+				e_idx = -1,
+			})
+			continue
+		}
+
+		// we're at a bottom node, grab the whole thing
+		child_count := get_child_count(depth, tree_idx)
+		if child_count <= 0 {
+			event_start_idx, event_end_idx := get_event_range(depth, tree_idx)
+
+			// the last leaf can be huge between builds, so skip to the window,
+			// and don't bother with events that would land under the last rect we pushed
+			oversized := event_end_idx - event_start_idx > BUCKET_SIZE
+			last_rect_end := min(f64)
+			if oversized {
+				event_start_idx = first_event_ending_after(trace, depth, thread.max_time, event_start_idx, event_end_idx, start_time)
+			}
+
+			for e_idx in event_start_idx..<event_end_idx {
+				ev := depth_event(depth, e_idx)
+				x := ev.timestamp - trace.total_min_time
+				if x > end_time {
+					break
+				}
+
+				duration := bound_duration(ev, thread.max_time)
+				if x + duration < start_time {
+					continue
+				}
+				if x + duration >= covered_start && x <= covered_end {
+					continue
+				}
+				if oversized && (f64(x + duration) * cam.current_scale) < last_rect_end {
+					continue
+				}
+
+				idx := name_color_idx(ev.name)
+				rect_color := trace.color_choices[idx]
+				grey := greyscale(trace.color_choices[idx])
+				if search_active(trace) && !name_is_hit(trace, ev.name) {
+					rect_color = grey
+				}
+				if multiselecting {
+					if range_start == -1 || !val_in_range(i32(e_idx), range_start, range_end - 1) {
+						rect_color = grey
+					}
+				}
+
+				append(&cache.items, RectCacheItem{
+					x     = f64(x) * cam.current_scale,
+					w     = max(f64(duration) * cam.current_scale, 2.0),
+					color = BVec4{u8(rect_color.x), u8(rect_color.y), u8(rect_color.z), 255},
+					e_idx = i32(e_idx),
+				})
+				last_rect_end = f64(x) * cam.current_scale + max(f64(duration) * cam.current_scale, 2.0)
+			}
+			continue
+		}
+
+		for i := child_count; i > 0; i -= 1 {
+			next_idx := get_left_child(tree_idx) + i - 1
+			tree_stack[stack_len] = next_idx; stack_len += 1
+		}
+	}
+}
+
+// Turns the cached rects into this frame's draws, and handles text, hover and clicks for the events
+draw_depth_rects :: proc(trace: ^Trace, ui_state: ^UIState, depth: ^Depth, p_idx, t_idx, d_idx: int, row_y: f64) {
+	full_flamegraph_rect := ui_state.full_flamegraph_rect
+	inner_flamegraph_rect := ui_state.inner_flamegraph_rect
+	h := ui_state.rect_height
+
+	graph_left  := inner_flamegraph_rect.x
+	graph_right := inner_flamegraph_rect.x + inner_flamegraph_rect.w
+	for item in depth.rect_cache.items {
+		// Carefully extract the [start, end] interval of the rect so that we can clip the left
+		// side to 0 before sending it to draw_rect, so we can prevent f32 (f64?) precision
+		// problems drawing a rectangle which starts at a massively huge negative number on
+		// the left.
+		r_x   := item.x + cam.pan.x + full_flamegraph_rect.x
+		end_x := r_x + item.w
+		if end_x < graph_left || r_x > graph_right {
+			continue
+		}
+		r_x = max(r_x, 0)
+
+		dr := Rect{r_x, row_y, end_x - r_x, h}
+		if item.e_idx == -1 {
+			append(&gl_rects, DrawRect{f32(dr.x), f32(dr.w), item.color})
+			rect_count += 1
+			bucket_count += 1
+			continue
+		}
+
+		e_idx := int(item.e_idx)
+		rect_color := item.color
+		if int(selected_event.pid) == p_idx && int(selected_event.tid) == t_idx &&
+		int(selected_event.did) == d_idx && int(selected_event.eid) == e_idx {
+			rect_color.x = u8(min(int(rect_color.x) + 30, 255))
+			rect_color.y = u8(min(int(rect_color.y) + 30, 255))
+			rect_color.z = u8(min(int(rect_color.z) + 30, 255))
+		}
+
+		append(&gl_rects, DrawRect{f32(dr.x), f32(dr.w), rect_color})
+		rect_count += 1
+
+		underhang := full_flamegraph_rect.x - dr.x
+		overhang := (full_flamegraph_rect.x + full_flamegraph_rect.w) - dr.x
+		disp_w := min(dr.w - underhang, dr.w, overhang)
+
+		text_pad := (em / 2)
+		text_width := int(math.floor((disp_w - (text_pad * 2)) / ch_width))
+		if text_width > 0 {
+			ev_name := in_getstr(&trace.string_block, event_name(depth, e_idx))
+			display_name := ev_name
+			if event_duration(depth, e_idx) == -1 {
+				display_name = fmt.tprintf("%s (Did Not Finish)", ev_name)
+			}
+
+			max_chars := max(0, min(len(display_name), text_width))
+			name_str := display_name[:max_chars]
+			str_x := max(dr.x, full_flamegraph_rect.x) + text_pad
+
+			if len(name_str) > 4 || max_chars == len(display_name) {
+				if max_chars != len(display_name) {
+					name_str = fmt.tprintf("%s…", name_str[:len(name_str)-1])
+				}
+
+				draw_text(name_str, Vec2{str_x, dr.y + (ui_state.rect_height / 2) - (em / 2)}, .PSize, .MonoFont, text_color3)
+			}
+		}
+
+		if pt_in_rect(mouse_pos, inner_flamegraph_rect) && pt_in_rect(mouse_pos, dr) {
+			set_cursor("pointer")
+			if !rendered_rect_tooltip && !shift_down {
+				rect_tooltip_pos = Vec2{dr.x, dr.y}
+				rect_tooltip_rect = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
+				rendered_rect_tooltip = true
+			}
+
+			if clicked && !shift_down {
+				pressed_event = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
+			}
+			if mouse_up_now && !shift_down {
+				released_event = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
+			}
+			if double_clicked && !shift_down {
+				trace.zoom_event = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
+			}
+		}
+	}
+}
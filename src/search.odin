@@ -0,0 +1,588 @@
+package main
+
+import "core:fmt"
+import "core:slice"
+import "core:unicode/utf8"
+
+// Name search
+//
+// At load time every depth gets a copy of its event indices sorted by name, so all the
+// calls to a given name are one contiguous (time-ordered) run we can binary search for.
+// A query matches names by substring over the interned strings, then marks which LOD
+// nodes contain a hit, so zoomed-out summary rects can light up without touching events.
+// A short query can hit most of a big trace, so the query waits for typing to settle,
+// and the depths get probed and marked a budget's worth per frame, see search_step.
+
+SEARCH_MAX_LEN     :: 256
+SEARCH_DEBOUNCE    :: 0.15 // seconds
+SEARCH_STEP_BUDGET :: 1024 * 1024
+
+SearchPosting :: struct {
+	pid: i32,
+	tid: i32,
+	did: i32,
+
+	// range into depth.name_index
+	start: u32,
+	end:   u32,
+}
+
+SearchState :: struct {
+	query_buf: [SEARCH_MAX_LEN]u8,
+	query_len: int,
+
+	focused: bool,
+	dirty:   bool,
+	edit_time: f64,
+
+	// sorted, so we can check names while drawing
+	names:    [dynamic]u32,
+	postings: [dynamic]SearchPosting,
+	hit_count: u64,
+
+	cur_hit: EventID,
+
+	// where search_step picks up, the next depth to probe and the next hit to mark
+	marking: bool,
+	probe_pid, probe_tid, probe_did: int,
+	mark_posting: int,
+	mark_offset:  u32,
+}
+
+init_search :: proc(trace: ^Trace) {
+	trace.search = SearchState{}
+	trace.search.names = make([dynamic]u32, big_global_allocator)
+	trace.search.postings = make([dynamic]SearchPosting, big_global_allocator)
+	trace.search.cur_hit = empty_event
+}
+
+search_query :: proc(trace: ^Trace) -> string {
+	return string(trace.search.query_buf[:trace.search.query_len])
+}
+
+search_active :: #force_inline proc(trace: ^Trace) -> bool {
+	return len(trace.search.names) > 0
+}
+
+build_name_indices :: proc(trace: ^Trace) {
+	for &proc_v in trace.processes {
+		for &tm in proc_v.threads {
+			for &depth in tm.depths {
+				build_depth_name_index(&depth)
+			}
+		}
+	}
+}
+
+// Also resizes hit_bits to match the depth's tree, so it has to happen after every LOD build
+build_depth_name_index :: proc(depth: ^Depth) {
+	event_count := depth_len(depth)
+	depth.name_index = reuse_slice(&depth.name_index_buf, event_count)
+	depth.hit_bits = reuse_slice(&depth.hit_bits_buf, i_round_up(len(depth.tree), 64) / 64)
+	zero_slice(depth.hit_bits)
+
+	// big depths spill the sort into big_global, drop that once we're done with it
+	sort_mem := arena_temp_begin(&big_global_arena)
+	alloc := radix_scratch_allocator(event_count)
+	items := make([]RadixItem, event_count, alloc)
+	tmp   := make([]RadixItem, event_count, alloc)
+	for i in 0..<event_count {
+		items[i] = RadixItem{key = u64(column_get(&depth.names, i)), idx = u32(i)}
+	}
+
+	// stable, so each name's run stays in event (and so time) order
+	sorted := items
+	if event_count > 0 {
+		sorted = radix_sort_items(items, tmp)
+	}
+
+	for item, i in sorted {
+		depth.name_index[i] = item.idx
+	}
+	arena_temp_end(sort_mem)
+	depth.tail_checked = event_count
+	depth.tail_hits = 0
+	free_all(scratch2_allocator)
+}
+
+// The [lo, hi) run of depth.name_index that holds name
+name_index_range :: proc(depth: ^Depth, name: u32) -> (u32, u32) {
+	index := depth.name_index
+
+	lo, hi := 0, len(index)
+	for lo < hi {
+		mid := (lo + hi) / 2
+		if column_get(&depth.names, int(index[mid])) < name {
+			lo = mid + 1
+		} else {
+			hi = mid
+		}
+	}
+	start := lo
+
+	hi = len(index)
+	for lo < hi {
+		mid := (lo + hi) / 2
+		if column_get(&depth.names, int(index[mid])) <= name {
+			lo = mid + 1
+		} else {
+			hi = mid
+		}
+	}
+
+	return u32(start), u32(lo)
+}
+
+name_is_hit :: proc(trace: ^Trace, name: u32) -> bool {
+	_, found := slice.binary_search(trace.search.names[:], name)
+	return found
+}
+
+node_has_hit :: #force_inline proc(depth: ^Depth, tree_idx: int) -> bool {
+	return (depth.hit_bits[tree_idx / 64] & (1 << uint(tree_idx % 64))) != 0
+}
+
+mark_hit :: proc(depth: ^Depth, e_idx: int) {
+	// anything past the last full bucket lives in the last leaf, see patch_lod_spine
+	tree_idx := leaf_tree_idx(depth, min(e_idx / BUCKET_SIZE, depth.leaf_count - 1))
+	for {
+		bit : u64 = 1 << uint(tree_idx % 64)
+		if depth.hit_bits[tree_idx / 64] & bit != 0 {
+			break
+		}
+		depth.hit_bits[tree_idx / 64] |= bit
+
+		if tree_idx == 0 {
+			break
+		}
+		tree_idx = (tree_idx - 1) / CHUNK_NARY_WIDTH
+	}
+}
+
+contains_fold :: proc(haystack, needle: string) -> bool {
+	if len(needle) > len(haystack) {
+		return false
+	}
+
+	outer: for i in 0..=(len(haystack) - len(needle)) {
+		for j in 0..<len(needle) {
+			a := haystack[i + j]
+			b := needle[j]
+			if a >= 'A' && a <= 'Z' { a += 'a' - 'A' }
+			if b >= 'A' && b <= 'Z' { b += 'a' - 'A' }
+			if a != b {
+				continue outer
+			}
+		}
+		return true
+	}
+	return false
+}
+
+// Finds the matching names, search_step does the rest
+run_search :: proc(trace: ^Trace) {
+	search := &trace.search
+	search.dirty = false
+	render_gen += 1
+	search.cur_hit = empty_event
+	search.hit_count = 0
+	search.marking = false
+
+	// only the depths we marked last time have anything to clear
+	for posting in search.postings {
+		depth := &trace.processes[posting.pid].threads[posting.tid].depths[posting.did]
+		slice.zero(depth.hit_bits)
+		depth.tail_hits = 0
+	}
+	non_zero_resize(&search.names, 0)
+	non_zero_resize(&search.postings, 0)
+
+	query := search_query(trace)
+	if len(query) == 0 {
+		return
+	}
+
+	for entry in trace.intern.entries {
+		if contains_fold(in_getstr(&trace.string_block, entry), query) {
+			non_zero_append(&search.names, entry)
+		}
+	}
+	if len(search.names) == 0 {
+		return
+	}
+	slice.sort(search.names[:])
+
+	search.probe_pid, search.probe_tid, search.probe_did = 0, 0, 0
+	search.mark_posting = 0
+	search.mark_offset = 0
+	search.marking = true
+}
+
+// Returns roughly how much work it did, the tail gets marked right away
+search_probe_depth :: proc(trace: ^Trace, p_idx, t_idx, d_idx: int) -> int {
+	search := &trace.search
+	depth := &trace.processes[p_idx].threads[t_idx].depths[d_idx]
+
+	for name in search.names {
+		start, end := name_index_range(depth, name)
+		if start == end {
+			continue
+		}
+
+		non_zero_append(&search.postings, SearchPosting{i32(p_idx), i32(t_idx), i32(d_idx), start, end})
+		search.hit_count += u64(end - start)
+	}
+
+	depth.tail_checked = len(depth.name_index)
+	depth.tail_hits = 0
+	return len(search.names) + search_mark_tail(trace, p_idx, t_idx, d_idx)
+}
+
+// While following, events land past the end of name_index until the depth gets rebuilt.
+// Those get checked one at a time; they count and light up, but jumping skips them until the rebuild.
+search_mark_tail :: proc(trace: ^Trace, p_idx, t_idx, d_idx: int) -> int {
+	search := &trace.search
+	depth := &trace.processes[p_idx].threads[t_idx].depths[d_idx]
+	if depth.leaf_count == 0 {
+		return 0
+	}
+
+	had_hits := depth.tail_hits > 0
+	event_count := depth_len(depth)
+	checked := event_count - depth.tail_checked
+	for i in depth.tail_checked..<event_count {
+		if name_is_hit(trace, column_get(&depth.names, i)) {
+			mark_hit(depth, i)
+			depth.tail_hits += 1
+			search.hit_count += 1
+		}
+	}
+	depth.tail_checked = event_count
+
+	// run_search only clears the depths it has postings for
+	if !had_hits && depth.tail_hits > 0 {
+		non_zero_append(&search.postings, SearchPosting{i32(p_idx), i32(t_idx), i32(d_idx), 0, 0})
+	}
+	return checked
+}
+
+// Whether search_step has already gotten to this depth
+search_probed :: proc(trace: ^Trace, p_idx, t_idx, d_idx: int) -> bool {
+	search := &trace.search
+	if p_idx != search.probe_pid {
+		return p_idx < search.probe_pid
+	}
+	if t_idx != search.probe_tid {
+		return t_idx < search.probe_tid
+	}
+	return d_idx < search.probe_did
+}
+
+SearchDepth :: struct {
+	pid: i32,
+	tid: i32,
+	did: i32,
+}
+
+// Re-probes depths that got rebuilt (and flagged search_stale) while following, instead of
+// redoing the whole search. Their new postings get marked by search_step like any others.
+search_redo_depths :: proc(trace: ^Trace, stale: []SearchDepth) {
+	search := &trace.search
+
+	// drop the stale postings, keeping mark_posting on the same one
+	kept := 0
+	next_mark := search.mark_posting
+	for posting, i in search.postings {
+		depth := &trace.processes[posting.pid].threads[posting.tid].depths[posting.did]
+		if !depth.search_stale {
+			search.postings[kept] = posting
+			kept += 1
+			continue
+		}
+
+		search.hit_count -= u64(posting.end - posting.start)
+		if i < search.mark_posting {
+			next_mark -= 1
+		} else if i == search.mark_posting {
+			search.mark_offset = 0
+		}
+	}
+	non_zero_resize(&search.postings, kept)
+	search.mark_posting = next_mark
+
+	// anything search_step hasn't gotten to yet gets probed when it does
+	for ref in stale {
+		if search_probed(trace, int(ref.pid), int(ref.tid), int(ref.did)) {
+			search_probe_depth(trace, int(ref.pid), int(ref.tid), int(ref.did))
+		}
+	}
+
+	search.marking = true
+	render_gen += 1
+}
+
+// Probes and marks depths until about budget work's been done, picking up where the last step left off.
+// Hits are only counted once their depth is probed, so the count climbs while this runs.
+search_step :: proc(trace: ^Trace, budget: int) {
+	search := &trace.search
+	render_gen += 1
+
+	work := 0
+	for work < budget {
+		// mark everything we've probed before moving on
+		if search.mark_posting < len(search.postings) {
+			posting := search.postings[search.mark_posting]
+			depth := &trace.processes[posting.pid].threads[posting.tid].depths[posting.did]
+
+			start := posting.start + search.mark_offset
+			end := posting.end
+			if int(end - start) > budget - work {
+				end = start + u32(budget - work)
+			}
+			for i in start..<end {
+				mark_hit(depth, int(depth.name_index[i]))
+			}
+			work += int(end - start)
+
+			search.mark_offset = end - posting.start
+			if end == posting.end {
+				search.mark_posting += 1
+				search.mark_offset = 0
+			}
+			continue
+		}
+
+		if search.probe_pid >= len(trace.processes) {
+			search.marking = false
+			return
+		}
+		proc_v := &trace.processes[search.probe_pid]
+		if search.probe_tid >= len(proc_v.threads) {
+			search.probe_pid += 1
+			search.probe_tid = 0
+			continue
+		}
+		tm := &proc_v.threads[search.probe_tid]
+		if search.probe_did >= len(tm.depths) {
+			search.probe_tid += 1
+			search.probe_did = 0
+			continue
+		}
+
+		work += search_probe_depth(trace, search.probe_pid, search.probe_tid, search.probe_did)
+		search.probe_did += 1
+	}
+}
+
+// hits are ordered by start time, then by where they sit in the graph
+hit_less :: proc(trace: ^Trace, a, b: EventID) -> bool {
+	a_start := event_start(&trace.processes[a.pid].threads[a.tid].depths[a.did], int(a.eid))
+	b_start := event_start(&trace.processes[b.pid].threads[b.tid].depths[b.did], int(b.eid))
+	if a_start != b_start { return a_start < b_start }
+	if a.pid != b.pid { return a.pid < b.pid }
+	if a.tid != b.tid { return a.tid < b.tid }
+	if a.did != b.did { return a.did < b.did }
+	return a.eid < b.eid
+}
+
+// Finds the hit just after (or before) cur, or the first (or last) one if there's no cur
+step_hit :: proc(trace: ^Trace, cur: EventID, forward: bool) -> (EventID, bool) {
+	has_cur := !event_cmp(cur, empty_event)
+
+	best := empty_event
+	found := false
+	for posting in trace.search.postings {
+		depth := &trace.processes[posting.pid].threads[posting.tid].depths[posting.did]
+		run := depth.name_index[posting.start:posting.end]
+		mk_id :: #force_inline proc(posting: SearchPosting, e_idx: u32) -> EventID {
+			return EventID{i64(posting.pid), i64(posting.tid), i64(posting.did), i64(e_idx)}
+		}
+
+		// runs are in time order, so find the first entry past cur and look around it
+		pos := 0
+		if has_cur {
+			lo, hi := 0, len(run)
+			for lo < hi {
+				mid := (lo + hi) / 2
+				if hit_less(trace, mk_id(posting, run[mid]), cur) || event_cmp(mk_id(posting, run[mid]), cur) {
+					lo = mid + 1
+				} else {
+					hi = mid
+				}
+			}
+			pos = lo
+		} else {
+			pos = forward ? 0 : len(run)
+		}
+
+		candidate: EventID
+		if forward {
+			if pos >= len(run) { continue }
+			candidate = mk_id(posting, run[pos])
+		} else {
+			// skip back over cur itself
+			for pos > 0 && has_cur && event_cmp(mk_id(posting, run[pos - 1]), cur) {
+				pos -= 1
+			}
+			if pos == 0 { continue }
+			candidate = mk_id(posting, run[pos - 1])
+		}
+
+		if !found || (forward ? hit_less(trace, candidate, best) : hit_less(trace, best, candidate)) {
+			best = candidate
+			found = true
+		}
+	}
+
+	return best, found
+}
+
+// Where a depth's row sits in the graph, relative to the top, same layout as draw_flamegraphs
+get_depth_y :: proc(trace: ^Trace, ui_state: ^UIState, pid, tid, did: i64) -> f64 {
+	cur_y := 0.0
+	for &proc_v, p_idx in trace.processes {
+		if len(trace.processes) > 1 {
+			cur_y += h1_height + (h1_height / 2)
+		}
+
+		for &thread, t_idx in proc_v.threads {
+			cur_y += h2_height + (h2_height / 2)
+			if i64(p_idx) == pid && i64(t_idx) == tid {
+				return cur_y + (ui_state.rect_height * f64(did))
+			}
+
+			cur_y += (f64(len(thread.depths)) * ui_state.rect_height) + thread_gap
+		}
+	}
+	return cur_y
+}
+
+jump_to_hit :: proc(trace: ^Trace, ui_state: ^UIState, forward: bool) {
+	// jumping needs every hit, so finish the search off right now
+	if trace.search.dirty {
+		run_search(trace)
+	}
+	if trace.search.marking {
+		search_step(trace, max(int))
+	}
+
+	hit, ok := step_hit(trace, trace.search.cur_hit, forward)
+	if !ok {
+		return
+	}
+
+	trace.search.cur_hit = hit
+	selected_event = hit
+
+	thread := &trace.processes[hit.pid].threads[hit.tid]
+	ev := depth_event(&thread.depths[hit.did], int(hit.eid))
+	duration := max(bound_duration(ev, thread.max_time), 1)
+
+	// leave some room either side, so you can see what the hit's sitting next to
+	set_flamegraph_camera(trace, ui_state, ev.timestamp - (duration / 2), duration * 2)
+	cam.pan.y = get_depth_y(trace, ui_state, hit.pid, hit.tid, hit.did) - (ui_state.padded_flamegraph_rect.h / 3)
+	ui_state.render_one_more = true
+}
+
+// Called once a frame with whatever got typed since the last one
+process_search_input :: proc(trace: ^Trace, ui_state: ^UIState) {
+	search := &trace.search
+
+	if search.dirty {
+		if t - search.edit_time >= SEARCH_DEBOUNCE {
+			run_search(trace)
+		}
+		ui_state.render_one_more = true
+	}
+	if search.marking {
+		search_step(trace, SEARCH_STEP_BUDGET)
+		ui_state.render_one_more = true
+	}
+
+	if !search.focused || loading_config {
+		typed_len = 0
+		return
+	}
+
+	for i := 0; i < typed_len; i += 1 {
+		buf, n := utf8.encode_rune(typed_chars[i])
+		if search.query_len + n > SEARCH_MAX_LEN {
+			break
+		}
+		copy(search.query_buf[search.query_len:], buf[:n])
+		search.query_len += n
+		search.dirty = true
+		search.edit_time = t
+	}
+	typed_len = 0
+
+	if .Backspace in pressed_keys && search.query_len > 0 {
+		// walk back over a whole codepoint
+		search.query_len -= 1
+		for search.query_len > 0 && (search.query_buf[search.query_len] & 0xC0) == 0x80 {
+			search.query_len -= 1
+		}
+		search.dirty = true
+		search.edit_time = t
+	}
+	if .Escape in pressed_keys {
+		search.query_len = 0
+		search.focused = false
+		search.dirty = true
+		search.edit_time = t
+	}
+
+	if search.dirty {
+		ui_state.render_one_more = true
+	}
+
+	if .Return in pressed_keys {
+		jump_to_hit(trace, ui_state, !shift_down)
+	}
+}
+
+draw_search_box :: proc(trace: ^Trace, ui_state: ^UIState, rect: Rect) {
+	search := &trace.search
+
+	if clicked {
+		search.focused = pt_in_rect(clicked_pos, rect)
+	}
+	if pt_in_rect(mouse_pos, rect) {
+		set_cursor("text")
+	}
+
+	draw_rect(rect, bg_color)
+	draw_rect_outline(rect, 1, search.focused ? toolbar_text_color : outline_color)
+
+	text_pad := em / 2
+	text_y := rect.y + (rect.h / 2) - (em / 2)
+
+	query := search_query(trace)
+	if len(query) == 0 && !search.focused {
+		draw_text("search names", Vec2{rect.x + text_pad, text_y}, .PSize, .DefaultFont, text_color2)
+		return
+	}
+
+	hits_str := ""
+	if len(query) > 0 {
+		hits_str = fmt_hits(trace)
+	}
+	hits_width := measure_text(hits_str, .PSize, .DefaultFont)
+	draw_text(hits_str, Vec2{rect.x + rect.w - hits_width - text_pad, text_y}, .PSize, .DefaultFont, text_color2)
+
+	query_str := trunc_string(query, text_pad, rect.w - hits_width - (text_pad * 3))
+	draw_text(query_str, Vec2{rect.x + text_pad, text_y}, .PSize, .MonoFont, text_color)
+	if search.focused {
+		caret_x := rect.x + text_pad + measure_text(query_str, .PSize, .MonoFont) + 1
+		draw_line(Vec2{caret_x, rect.y + text_pad}, Vec2{caret_x, rect.y + rect.h - text_pad}, 1, text_color)
+	}
+}
+
+fmt_hits :: proc(trace: ^Trace) -> string {
+	if trace.search.hit_count == 0 {
+		return "no hits"
+	}
+
+	more := trace.search.marking ? "+" : ""
+	return fmt.tprintf("%d%s %s", trace.search.hit_count, more, trace.search.hit_count == 1 ? "hit" : "hits")
+}
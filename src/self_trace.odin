@@ -0,0 +1,167 @@
+package main
+
+import "core:mem"
+import "core:sys/wasm/js"
+import "formats:spall"
+
+// Self-tracing
+//
+// When recording, the viewer writes Begin/End zones around its own ingest and frame phases
+// into an in-memory v3 spall file, the same bytes spall.h would produce, so it can be
+// exported and loaded right back into the viewer. Each recording gets one buffer block,
+// and the whole thing is one fixed page allocation; once it's full, recording stops.
+// Recording only starts and stops between frames, so frame zones always come out balanced.
+
+SELF_TRACE_SIZE :: 16 * 1024 * 1024
+SELF_TRACE_PID  :: 0
+SELF_TRACE_TID  :: 0
+
+SelfTrace :: struct {
+	buffer: []u8,
+	pos: int,
+	block_start: int, // -1 if there's no block open
+	open_zones: int,
+	suppressed_zones: int, // begins that didn't fit, so their ends have nothing to close
+
+	recording: bool,
+	want_recording: bool,
+	want_export: bool,
+	full: bool,
+}
+self_trace := SelfTrace{block_start = -1}
+
+self_trace_now :: #force_inline proc() -> u64 {
+	return u64(get_precise_time() * 1_000_000)
+}
+
+self_trace_write :: #force_inline proc(data: []u8) {
+	copy(self_trace.buffer[self_trace.pos:], data)
+	self_trace.pos += len(data)
+}
+
+self_trace_write_val :: #force_inline proc(val: ^$T) {
+	self_trace_write(mem.ptr_to_bytes(val))
+}
+
+self_trace_open_block :: proc() {
+	st := &self_trace
+
+	// the backing pages never get freed, so only grab them once somebody asks
+	if st.buffer == nil {
+		data, err := js.page_alloc(SELF_TRACE_SIZE / js.PAGE_SIZE)
+		if err != nil {
+			st.full = true
+			return
+		}
+		st.buffer = data
+
+		hdr := spall.Manual_Header{
+			magic          = spall.MANUAL_MAGIC,
+			version        = 3,
+			timestamp_unit = 1, // ns
+		}
+		self_trace_write_val(&hdr)
+	}
+
+	name_sz := size_of(spall.Name_Container) * 2 + len("spall") + len("main")
+	if st.pos + size_of(spall.Manual_Buffer_Header) + name_sz > len(st.buffer) {
+		st.full = true
+		return
+	}
+
+	st.block_start = st.pos
+	bhdr := spall.Manual_Buffer_Header{pid = SELF_TRACE_PID, tid = SELF_TRACE_TID, first_ts = self_trace_now()}
+	self_trace_write_val(&bhdr)
+
+	self_trace_write_name(.Name_Process, "spall")
+	self_trace_write_name(.Name_Thread, "main")
+
+	st.open_zones = 0
+	st.suppressed_zones = 0
+	st.recording = true
+}
+
+self_trace_write_name :: proc(type: spall.Manual_Event_Type, name: string) {
+	ev := spall.Name_Container{type = type, name_len = u8(len(name))}
+	self_trace_write_val(&ev)
+	self_trace_write(transmute([]u8)name)
+}
+
+// Patches the block's size now that we know it. Any zones still open come out as unfinished.
+self_trace_close_block :: proc() {
+	st := &self_trace
+	if st.block_start == -1 {
+		return
+	}
+
+	bhdr := (^spall.Manual_Buffer_Header)(&st.buffer[st.block_start])
+	bhdr.size = u32(st.pos - st.block_start - size_of(spall.Manual_Buffer_Header))
+
+	st.block_start = -1
+	st.recording = false
+}
+
+self_trace_begin :: proc(name: string) {
+	st := &self_trace
+	if !st.recording {
+		return
+	}
+
+	name := name[:min(len(name), 255)]
+	ev := spall.Begin_Event_V2{type = .Begin, time = self_trace_now(), name_len = u8(len(name))}
+
+	// leave room to close everything that's open, including this one.
+	// once one zone doesn't fit, nothing inside it gets written either, so the ends still pair up
+	ev_sz := size_of(spall.Begin_Event_V2) + len(name)
+	if st.suppressed_zones > 0 || st.pos + ev_sz + ((st.open_zones + 1) * size_of(spall.End_Event_V2)) > len(st.buffer) {
+		st.full = true
+		st.want_recording = false
+		st.suppressed_zones += 1
+		return
+	}
+
+	self_trace_write_val(&ev)
+	self_trace_write(transmute([]u8)name)
+	st.open_zones += 1
+}
+
+self_trace_end :: proc() {
+	st := &self_trace
+
+	if !st.recording {
+		return
+	}
+	if st.suppressed_zones > 0 {
+		st.suppressed_zones -= 1
+		return
+	}
+
+	// zones that started before the recording did don't get an end
+	if st.open_zones == 0 {
+		return
+	}
+
+	ev := spall.End_Event_V2{type = .End, time = self_trace_now()}
+	self_trace_write_val(&ev)
+	st.open_zones -= 1
+}
+
+// Called at the top of every frame, before anything's been traced, to apply button presses from the last one
+self_trace_frame_start :: proc() {
+	st := &self_trace
+
+	if st.want_export {
+		self_trace_close_block()
+		if st.pos > 0 {
+			save_file("spall_self_trace.spall", st.buffer[:st.pos])
+		}
+		st.want_export = false
+	}
+
+	if st.want_recording && st.block_start == -1 && !st.full {
+		self_trace_open_block()
+	} else if !st.want_recording && st.block_start != -1 {
+		self_trace_close_block()
+	}
+	st.want_recording = st.recording
+}
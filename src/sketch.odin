@@ -0,0 +1,151 @@
+package main
+
+import "core:math"
+
+// DDSketch-style quantile sketch over event durations.
+//
+// Bucket k holds values in (gamma^(k-1), gamma^k], so any quantile we hand back is within
+// SKETCH_ALPHA of the real value. We only keep a window of SKETCH_BUCKETS keys; if the data
+// spans more than that, the lowest buckets get collapsed together, which costs accuracy at
+// the bottom end but keeps the tail (the bit anyone actually asks about) exact to alpha.
+// Sketches merge by adding buckets, so they can be built up in any order.
+
+SKETCH_ALPHA        :: 0.02
+SKETCH_GAMMA        :: (1 + SKETCH_ALPHA) / (1 - SKETCH_ALPHA)
+SKETCH_INV_LN_GAMMA :: 24.996666311036567 // 1 / ln(SKETCH_GAMMA)
+SKETCH_BUCKETS      :: 256
+
+sketch_key :: #force_inline proc(val: f64) -> i32 {
+	return i32(math.ceil(math.ln(val) * SKETCH_INV_LN_GAMMA))
+}
+
+// the middle of bucket key, in the same units we were fed
+sketch_value :: #force_inline proc(key: i32) -> f64 {
+	return math.pow(SKETCH_GAMMA, f64(key)) * (2 / (SKETCH_GAMMA + 1))
+}
+
+sketch_insert :: proc(s: ^QuantileSketch, val: i64) {
+	if val <= 0 {
+		s.zero_count += 1
+		s.count += 1
+		return
+	}
+
+	sketch_add_key(s, sketch_key(f64(val)), 1)
+}
+
+sketch_add_key :: proc(s: ^QuantileSketch, key: i32, n: u32) {
+	// first real value, center the window on it
+	if s.count == s.zero_count {
+		s.min_key = key - (SKETCH_BUCKETS / 2)
+	}
+	s.count += n
+
+	if key >= s.min_key + SKETCH_BUCKETS {
+		sketch_collapse_low(s, key - (SKETCH_BUCKETS - 1))
+	} else if key < s.min_key {
+		// slide the window down if there's empty room at the top, otherwise this lands in the collapsed bucket
+		top := SKETCH_BUCKETS - 1
+		for top > 0 && s.counts[top] == 0 {
+			top -= 1
+		}
+
+		shift := min(int(s.min_key - key), SKETCH_BUCKETS - 1 - top)
+		if shift > 0 {
+			for i := top; i >= 0; i -= 1 {
+				s.counts[i + shift] = s.counts[i]
+			}
+			for i in 0..<shift {
+				s.counts[i] = 0
+			}
+			s.min_key -= i32(shift)
+		}
+
+		if key < s.min_key {
+			s.counts[0] += n
+			return
+		}
+	}
+
+	s.counts[key - s.min_key] += n
+}
+
+// slides the window up to start at new_min_key, folding everything that falls off the bottom into bucket 0,
+// however far that is
+sketch_collapse_low :: proc(s: ^QuantileSketch, new_min_key: i32) {
+	shift := int(new_min_key - s.min_key)
+
+	collapsed : u32 = 0
+	for i in 0..<min(shift + 1, SKETCH_BUCKETS) {
+		collapsed += s.counts[i]
+	}
+
+	for i in 1..<SKETCH_BUCKETS {
+		src := i + shift
+		s.counts[i] = src < SKETCH_BUCKETS ? s.counts[src] : 0
+	}
+	s.counts[0] = collapsed
+	s.min_key = new_min_key
+}
+
+sketch_merge :: proc(dst: ^QuantileSketch, src: ^QuantileSketch) {
+	dst.zero_count += src.zero_count
+	dst.count += src.zero_count
+
+	for c, i in src.counts {
+		if c > 0 {
+			sketch_add_key(dst, src.min_key + i32(i), c)
+		}
+	}
+}
+
+sketch_quantile :: proc(s: ^QuantileSketch, q: f64) -> f64 {
+	if s.count == 0 {
+		return 0
+	}
+
+	rank := u32(q * f64(s.count - 1))
+	if rank < s.zero_count {
+		return 0
+	}
+
+	seen := s.zero_count
+	for c, i in s.counts {
+		seen += c
+		if seen > rank {
+			return sketch_value(s.min_key + i32(i))
+		}
+	}
+	return sketch_value(s.min_key + SKETCH_BUCKETS - 1)
+}
+
+// Squashes the populated part of the sketch into len(bins) log-scaled bins,
+// returns the values at the left and right edges of the range
+sketch_histogram :: proc(s: ^QuantileSketch, bins: []f64) -> (low_val, high_val: f64) {
+	for &bin in bins {
+		bin = 0
+	}
+	if s.count == 0 || len(bins) == 0 {
+		return 0, 0
+	}
+
+	low := 0
+	for low < SKETCH_BUCKETS - 1 && s.counts[low] == 0 {
+		low += 1
+	}
+	high := SKETCH_BUCKETS - 1
+	for high > low && s.counts[high] == 0 {
+		high -= 1
+	}
+
+	// zero-length events go in with the smallest ones
+	bins[0] += f64(s.zero_count)
+
+	key_span := high - low + 1
+	for i in low..=high {
+		bin := ((i - low) * len(bins)) / key_span
+		bins[bin] += f64(s.counts[i])
+	}
+
+	return sketch_value(s.min_key + i32(low)), sketch_value(s.min_key + i32(high))
+}
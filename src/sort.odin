@@ -0,0 +1,94 @@
+package main
+
+import "core:mem"
+
+// LSD radix sort over (key, idx) pairs, for the big event arrays where a comparison
+// sort (or worse, an insertion sort) falls over on badly shuffled input.
+// Sort the pairs, then move the real data once with permute_by_items.
+
+RadixItem :: struct {
+	key: u64,
+	idx: u32,
+}
+
+// maps an i64 onto a u64 that sorts the same way
+radix_key_i64 :: #force_inline proc(val: i64) -> u64 {
+	return u64(val) ~ (1 << 63)
+}
+
+// The sort buffers only live until the caller's next free_all(scratch2_allocator),
+// only spill the really big ones into big_global
+radix_scratch_allocator :: proc(count: int) -> mem.Allocator {
+	if (2 * count * size_of(RadixItem)) + 64 > len(scratch2_arena.data) - scratch2_arena.offset {
+		return big_global_allocator
+	}
+	return scratch2_allocator
+}
+
+// Stable, so chaining sorts from the least to the most significant key works.
+// Returns whichever of the two buffers ended up holding the result.
+radix_sort_items :: proc(items, tmp: []RadixItem) -> []RadixItem #no_bounds_check {
+	RADIX_BITS :: 8
+	RADIX_PASSES :: 64 / RADIX_BITS
+	RADIX_BUCKETS :: 1 << RADIX_BITS
+
+	// one pass to grab every digit histogram up front
+	counts := [RADIX_PASSES][RADIX_BUCKETS]int{}
+	for item in items {
+		key := item.key
+		for pass in 0..<RADIX_PASSES {
+			counts[pass][(key >> uint(pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)] += 1
+		}
+	}
+
+	src := items
+	dst := tmp
+	for pass in 0..<RADIX_PASSES {
+		// every key has the same digit here, nothing would move
+		if counts[pass][(items[0].key >> uint(pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)] == len(items) {
+			continue
+		}
+
+		offsets := [RADIX_BUCKETS]int{}
+		total := 0
+		for i in 0..<RADIX_BUCKETS {
+			offsets[i] = total
+			total += counts[pass][i]
+		}
+
+		shift := uint(pass * RADIX_BITS)
+		for item in src {
+			digit := (item.key >> shift) & (RADIX_BUCKETS - 1)
+			dst[offsets[digit]] = item
+			offsets[digit] += 1
+		}
+
+		src, dst = dst, src
+	}
+
+	return src
+}
+
+// Moves data[items[i].idx] into data[i], following permutation cycles so we don't need
+// a second copy of data. Clobbers the idxs in items.
+permute_by_items :: proc(data: []$T, items: []RadixItem) #no_bounds_check {
+	for i in 0..<len(items) {
+		if items[i].idx == u32(i) {
+			continue
+		}
+
+		temp := data[i]
+		j := i
+		for {
+			k := int(items[j].idx)
+			items[j].idx = u32(j)
+			if k == i {
+				data[j] = temp
+				break
+			}
+
+			data[j] = data[k]
+			j = k
+		}
+	}
+}
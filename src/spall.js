@@ -161,6 +161,13 @@ let cached_height = 0;
 
 let loading_file = null;
 let loading_reader = null;
+
+// Following a file that's still being written, see follow.odin
+const FOLLOW_POLL_MS = 500;
+const FOLLOW_CHUNK_SIZE = 10 * 1024 * 1024;
+let follow_url = null;
+let follow_pos = 0;
+let follow_timer = null;
 let everythings_dead = false;
 
 function implode() {
@@ -345,6 +352,7 @@ async function init() {
 					sessionStorage.setItem(key, val);
 				},
 				get_time() { return Date.now(); },
+				get_precise_time() { return performance.now(); },
 				get_system_color() { return get_system_colormode() },
 				_pow(x, power) { return Math.pow(x, power); },
 				change_cursor(p, len) {
@@ -378,6 +386,22 @@ async function init() {
 
 				open_file_dialog() {
 					document.getElementById('file-dialog').click();
+				},
+				save_file(n, nlen, ptr, len) {
+					let name = window.wasm.odinMem.loadString(n, nlen);
+					let data = window.wasm.odinMem.loadBytes(ptr, len);
+
+					// copy it out, the wasm memory under it can move
+					let blob = new Blob([data.slice()], { type: "application/octet-stream" });
+					let url = URL.createObjectURL(blob);
+
+					let link = document.createElement('a');
+					link.href = url;
+					link.download = name;
+					link.click();
+
+					// revoking right after the click can cancel the download in some browsers
+					setTimeout(() => URL.revokeObjectURL(url), 1000);
 				}
 			},
 		});
@@ -388,6 +412,7 @@ async function init() {
 	}
 
 	function load_file(file) {
+		stop_following();
 		loading_file = file;
 		loading_reader = new FileReader();
 
@@ -401,6 +426,83 @@ async function init() {
 		}
 	}
 
+	function stop_following() {
+		follow_url = null;
+		if (follow_timer !== null) {
+			clearTimeout(follow_timer);
+			follow_timer = null;
+		}
+	}
+
+	function follow_file(url) {
+		stop_following();
+		follow_url = url;
+		follow_pos = 0;
+
+		try {
+			window.wasm.start_following(...str(url));
+			wakeUp();
+		} catch (e) {
+			console.error(e);
+			implode();
+			return;
+		}
+
+		poll_follow(url);
+	}
+
+	// Grabs whatever got appended since last time with a range request,
+	// servers that ignore the range just hand back the whole file
+	async function poll_follow(url) {
+		follow_timer = null;
+
+		let got = 0;
+		try {
+			let resp = await fetch(url, {
+				headers: { "Range": `bytes=${follow_pos}-${follow_pos + FOLLOW_CHUNK_SIZE - 1}` },
+				cache: "no-store",
+			});
+			if (url !== follow_url) {
+				return;
+			}
+
+			// 416 just means nothing's been written since the last poll
+			if (resp.status === 200 || resp.status === 206) {
+				let buf = await resp.arrayBuffer();
+				if (url !== follow_url) {
+					return;
+				}
+				if (resp.status === 200) {
+					buf = buf.slice(follow_pos, follow_pos + FOLLOW_CHUNK_SIZE);
+				}
+
+				got = buf.byteLength;
+				if (got > 0) {
+					follow_pos += got;
+					try {
+						window.wasm.load_follow_chunk(...bytes(buf));
+						wakeUp();
+					} catch (e) {
+						console.error(e);
+						implode();
+						stop_following();
+						return;
+					}
+				}
+			}
+		} catch (e) {
+			console.log("Failed to poll " + url + ": " + e);
+		}
+
+		if (url !== follow_url) {
+			return;
+		}
+
+		// a full chunk probably means there's more waiting, so don't sleep on it
+		let delay = (got === FOLLOW_CHUNK_SIZE) ? 0 : FOLLOW_POLL_MS;
+		follow_timer = setTimeout(() => poll_follow(url), delay);
+	}
+
 	let fd = document.getElementById('file-dialog');
 	fd.addEventListener("change", () => {
 		if (fd.files.length == 0) {
@@ -535,6 +637,7 @@ async function init() {
 		MU_KEY_HOME         = (1 << 10),
 		MU_KEY_END          = (1 << 11),
 		MU_KEY_TAB          = (1 << 12),
+		MU_KEY_ESCAPE       = (1 << 13),
 		*/
 
 		if (e.key === 'Shift') {
@@ -563,6 +666,8 @@ async function init() {
 			func(1 << 11);
 		} else if (e.key === 'Tab') {
 			func(1 << 12);
+		} else if (e.key === 'Escape') {
+			func(1 << 13);
 		}
 
 		wakeUp();
@@ -572,6 +677,9 @@ async function init() {
 			specialKeyEvent('down', e);
 		} else if ( !(e.ctrlKey || e.metaKey) || e.code == 'KeyA' || e.code == 'KeyZ') {
 			e.preventDefault();
+			if (!(e.ctrlKey || e.metaKey)) {
+				window.wasm.char_input(e.key.codePointAt(0));
+			}
 		}
 		wakeUp();
 	});
@@ -688,6 +796,13 @@ async function init() {
 			console.error(error);
 		}
 	}
+
+	// spall.html?follow=<url> tails a trace that's still being written
+	let follow_param = new URLSearchParams(window.location.search).get("follow");
+	if (follow_param) {
+		follow_file(follow_param);
+	}
+
 	wakeUp();
 }
 
@@ -0,0 +1,265 @@
+package main
+
+import "core:slice"
+
+// Per-depth stat summaries, so range stats don't have to touch every event.
+//
+// Level 0 has one node per AGG_BLOCK_SIZE events, each holding a name-sorted list of
+// per-name aggregates. Every level above merges AGG_FANOUT nodes from the level below.
+// A range query only scans the events in its two partial edge blocks, and covers
+// everything else with at most 2 * (AGG_FANOUT - 1) nodes per level.
+//
+// With lots of distinct names, the aggregates stop being any smaller than the events they
+// cover, so level 0 has to shrink the events by AGG_MIN_SHRINK or the depth just gets scanned,
+// and we stop adding levels once merging doesn't at least halve the entries. That keeps
+// a depth's summary under 2 * size_of(NameAgg) / AGG_MIN_SHRINK (10) bytes per event, same as the columns.
+// Level 0 gets built in scratch2 and only copied over once it's passed that check, so a depth
+// that bails doesn't leave its biggest allocation behind in big_global.
+
+AGG_BLOCK_SIZE :: 1024
+AGG_FANOUT     :: 8
+AGG_HASH_SIZE  :: 2 * AGG_BLOCK_SIZE
+AGG_MIN_SHRINK :: 8
+
+agg_name_less :: proc(a, b: NameAgg) -> bool {
+	return a.name < b.name
+}
+
+agg_merge :: #force_inline proc(dst: ^NameAgg, src: NameAgg) {
+	dst.count      += src.count
+	dst.total_time += src.total_time
+	dst.self_time  += src.self_time
+	dst.min_time    = min(dst.min_time, src.min_time)
+	dst.max_time    = max(dst.max_time, src.max_time)
+}
+
+build_stat_summaries :: proc(trace: ^Trace) {
+	for &proc_v in trace.processes {
+		for &tm in proc_v.threads {
+			for _, d_idx in tm.depths {
+				build_depth_summary(trace, &tm, d_idx)
+				free_all(scratch_allocator)
+				free_all(scratch2_allocator)
+			}
+		}
+	}
+}
+
+build_depth_summary :: proc(trace: ^Trace, thread: ^Thread, d_idx: int) {
+	depth := &thread.depths[d_idx]
+	event_count := depth_len(depth)
+	if event_count == 0 {
+		depth.agg_levels = nil
+		return
+	}
+
+	block_count := i_round_up(event_count, AGG_BLOCK_SIZE) / AGG_BLOCK_SIZE
+	level_count := 1
+	for nodes := block_count; nodes > 1; nodes = i_round_up(nodes, AGG_FANOUT) / AGG_FANOUT {
+		level_count += 1
+	}
+	// the most level 0 can hold before the shrink check trips, plus a block's worth of slack,
+	// twice over for the array doubling. Depths too big for scratch2 build in place, and roll
+	// big_global back if they bail
+	level0_size := (2 * ((event_count / AGG_MIN_SHRINK) + AGG_BLOCK_SIZE) * size_of(NameAgg)) + ((block_count + 1) * size_of(u32)) + 64
+	in_place := level0_size > len(scratch2_arena.data) - scratch2_arena.offset
+	level0_allocator := in_place ? big_global_allocator : scratch2_allocator
+
+	// nothing else touches big_global while we build, so bailing can just rewind it
+	level_mem := arena_temp_begin(&big_global_arena)
+	depth.agg_levels = make([]AggLevel, level_count, big_global_allocator)
+
+	// level 0, straight from the events
+	{
+		level := &depth.agg_levels[0]
+		offsets := make([]u32, block_count + 1, level0_allocator)
+		entries := make([dynamic]NameAgg, level0_allocator)
+
+		self_times := make([]i64, AGG_BLOCK_SIZE, scratch_allocator)
+		slots := make([]i32, AGG_HASH_SIZE, scratch_allocator)
+		child_idx := 0
+
+		for b in 0..<block_count {
+			start := b * AGG_BLOCK_SIZE
+			end := min(start + AGG_BLOCK_SIZE, event_count)
+			sweep_self_times(trace, thread, d_idx, start, self_times[:end - start], &child_idx)
+
+			block_start := len(entries)
+			slice.fill(slots, -1)
+			for e_idx in start..<end {
+				ev := depth_event(depth, e_idx)
+				ev_agg := NameAgg{
+					name       = ev.name,
+					count      = 1,
+					total_time = bound_duration(ev, thread.max_time),
+					self_time  = self_times[e_idx - start],
+				}
+				ev_agg.min_time = ev_agg.total_time
+				ev_agg.max_time = ev_agg.total_time
+
+				hv := sm_hash(ev.name) & (AGG_HASH_SIZE - 1)
+				for {
+					slot := slots[hv]
+					if slot == -1 {
+						slots[hv] = i32(len(entries) - block_start)
+						append_column(&entries, ev_agg)
+						break
+					}
+
+					agg := &entries[block_start + int(slot)]
+					if agg.name == ev.name {
+						agg_merge(agg, ev_agg)
+						break
+					}
+					hv = (hv + 1) & (AGG_HASH_SIZE - 1)
+				}
+			}
+
+			slice.sort_by(entries[block_start:], agg_name_less)
+			offsets[b + 1] = u32(len(entries))
+
+			if len(entries) * AGG_MIN_SHRINK > end {
+				depth.agg_levels = nil
+				arena_temp_end(level_mem)
+				return
+			}
+		}
+
+		if in_place {
+			level.offsets = offsets
+			level.entries = entries[:]
+		} else {
+			level.offsets = slice.clone(offsets, big_global_allocator)
+			level.entries = slice.clone(entries[:], big_global_allocator)
+		}
+	}
+
+	// every level above merges AGG_FANOUT nodes from the one below
+	for l in 1..<level_count {
+		below := &depth.agg_levels[l - 1]
+		below_count := len(below.offsets) - 1
+		node_count := i_round_up(below_count, AGG_FANOUT) / AGG_FANOUT
+
+		level := &depth.agg_levels[l]
+		level_mem = arena_temp_begin(&big_global_arena)
+		level.offsets = make([]u32, node_count + 1, big_global_allocator)
+		entries := make([dynamic]NameAgg, big_global_allocator)
+
+		for n in 0..<node_count {
+			first := below.offsets[n * AGG_FANOUT]
+			last := below.offsets[min((n + 1) * AGG_FANOUT, below_count)]
+
+			node_start := len(entries)
+			for agg in below.entries[first:last] {
+				append_column(&entries, agg)
+			}
+			slice.sort_by(entries[node_start:], agg_name_less)
+
+			out := node_start
+			for i in node_start..<len(entries) {
+				if out > node_start && entries[out - 1].name == entries[i].name {
+					agg_merge(&entries[out - 1], entries[i])
+				} else {
+					entries[out] = entries[i]
+					out += 1
+				}
+			}
+			non_zero_resize(&entries, out)
+			level.offsets[n + 1] = u32(out)
+
+			// not worth a level, the range query just walks more nodes on the one below
+			if len(entries) * 2 > int(last) {
+				depth.agg_levels = depth.agg_levels[:l]
+				arena_temp_end(level_mem)
+				return
+			}
+		}
+		level.entries = entries[:]
+	}
+}
+
+// Folds the stats for events [start, end) of a depth into stats.
+// Returns the total time those events cover.
+depth_range_stats :: proc(trace: ^Trace, thread: ^Thread, d_idx, start, end: int, stats: ^StatMap) -> i64 {
+	depth := &thread.depths[d_idx]
+	if len(depth.agg_levels) == 0 {
+		return scan_range_stats(trace, thread, d_idx, start, end, stats)
+	}
+
+	lo := i_round_up(start, AGG_BLOCK_SIZE) / AGG_BLOCK_SIZE
+	hi := end / AGG_BLOCK_SIZE
+	if lo >= hi {
+		return scan_range_stats(trace, thread, d_idx, start, end, stats)
+	}
+
+	tracked_time : i64 = 0
+	tracked_time += scan_range_stats(trace, thread, d_idx, start, lo * AGG_BLOCK_SIZE, stats)
+	tracked_time += scan_range_stats(trace, thread, d_idx, hi * AGG_BLOCK_SIZE, end, stats)
+
+	level := 0
+	for lo < hi {
+		if level + 1 >= len(depth.agg_levels) {
+			for n in lo..<hi {
+				tracked_time += add_summary_node(&depth.agg_levels[level], n, stats)
+			}
+			break
+		}
+
+		// peel off the nodes that don't line up with a parent, then go up a level
+		for lo < hi && lo % AGG_FANOUT != 0 {
+			tracked_time += add_summary_node(&depth.agg_levels[level], lo, stats)
+			lo += 1
+		}
+		for lo < hi && hi % AGG_FANOUT != 0 {
+			hi -= 1
+			tracked_time += add_summary_node(&depth.agg_levels[level], hi, stats)
+		}
+
+		lo /= AGG_FANOUT
+		hi /= AGG_FANOUT
+		level += 1
+	}
+
+	return tracked_time
+}
+
+add_summary_node :: proc(level: ^AggLevel, node: int, stats: ^StatMap) -> i64 {
+	tracked_time : i64 = 0
+	for agg in level.entries[level.offsets[node]:level.offsets[node + 1]] {
+		s, ok := sm_get(stats, agg.name)
+		if !ok {
+			s = sm_insert(stats, agg.name, Stats{min_time = max(i64), max_time = min(i64)})
+		}
+
+		s.count      += agg.count
+		s.total_time += agg.total_time
+		s.self_time  += agg.self_time
+		s.min_time    = min(s.min_time, agg.min_time)
+		s.max_time    = max(s.max_time, agg.max_time)
+		tracked_time += agg.total_time
+	}
+	return tracked_time
+}
+
+scan_range_stats :: proc(trace: ^Trace, thread: ^Thread, d_idx, start, end: int, stats: ^StatMap) -> i64 {
+	depth := &thread.depths[d_idx]
+
+	tracked_time : i64 = 0
+	for e_idx in start..<end {
+		ev := depth_event(depth, e_idx)
+		duration := bound_duration(ev, thread.max_time)
+
+		s, ok := sm_get(stats, ev.name)
+		if !ok {
+			s = sm_insert(stats, ev.name, Stats{min_time = max(i64), max_time = min(i64)})
+		}
+
+		s.count += 1
+		s.total_time += duration
+		s.self_time += get_self_time(trace, thread, d_idx, e_idx)
+		s.min_time = min(s.min_time, duration)
+		s.max_time = max(s.max_time, duration)
+		tracked_time += duration
+	}
+	return tracked_time
+}
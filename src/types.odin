@@ -60,6 +60,7 @@ UIState :: struct {
 	multiselecting: bool,
 	resizing_pane: bool,
 	filters_open: bool,
+	calltree_open: bool,
 
 	grip_delta: f64,
 }
@@ -121,13 +122,19 @@ event_cmp :: proc(ev1, ev2: EventID) -> bool {
 	   ev1.eid == ev2.eid
 	)
 }
-get_event :: proc(trace: ^Trace, ev_id: EventID) -> ^Event {
+get_event :: proc(trace: ^Trace, ev_id: EventID) -> Event {
 	p_idx := ev_id.pid
 	t_idx := ev_id.tid
-	d_idx := ev_id.did
-	e_idx := ev_id.eid
+	d_idx := int(ev_id.did)
+	e_idx := int(ev_id.eid)
 
-	return &trace.processes[p_idx].threads[t_idx].depths[d_idx].events[e_idx]
+	thread := &trace.processes[p_idx].threads[t_idx]
+	depth := &thread.depths[d_idx]
+
+	ev := depth_event(depth, e_idx)
+	ev.args = event_args(depth, e_idx)
+	ev.self_time = get_self_time(trace, thread, d_idx, e_idx)
+	return ev
 }
 
 Stats :: struct {
@@ -137,7 +144,16 @@ Stats :: struct {
 	min_time:   i64,
 	max_time:   i64,
 	count:      u32,
-	hist:  [100]f64,
+	p50:        f64,
+	p99:        f64,
+	p999:       f64,
+	sketch:     QuantileSketch,
+}
+QuantileSketch :: struct {
+	counts:     [SKETCH_BUCKETS]u32,
+	min_key:    i32,
+	zero_count: u32,
+	count:      u32,
 }
 Range :: struct {
 	pid: i32,
@@ -159,6 +175,9 @@ SortState :: enum {
 	MinTime,
 	MaxTime,
 	AvgTime,
+	P50,
+	P99,
+	P999,
 	Count,
 }
 StatOffset :: struct {
@@ -204,7 +223,8 @@ JSONEvent :: struct #packed {
 	duration: i64,
 	self_time: i64,
 }
-Event :: struct #packed {
+// Unpacked copy of a single event, see events.odin for how they're actually stored
+Event :: struct {
 	name: u32,
 	args: u32,
 	timestamp: i64,
@@ -237,6 +257,15 @@ Trace :: struct {
 	stamp_scale: f64,
 
 	zoom_event: EventID,
+	search: SearchState,
+	activity: TraceActivity,
+	calltree: CallTree,
+
+	// set once we've started drawing a file that's still loading
+	progressive: bool,
+	lod_min_time: i64,
+
+	follow: FollowState,
 
 	file_name: string,
 	file_name_store: [1024]u8,
@@ -255,12 +284,82 @@ ChunkNode :: struct #packed {
 	weight: i64,
 }
 
+// For spilling the odd event that won't fit in the 32-bit columns
+WideEntry :: struct {
+	idx: i32,
+	val: i64,
+}
+ArgEntry :: struct {
+	idx:  i32,
+	args: u32,
+}
+
+NameAgg :: struct {
+	name:       u32,
+	count:      u32,
+	total_time: i64,
+	self_time:  i64,
+	min_time:   i64,
+	max_time:   i64,
+}
+// node n's aggregates are entries[offsets[n]:offsets[n+1]], sorted by name
+AggLevel :: struct {
+	offsets: []u32,
+	entries: []NameAgg,
+}
+
+// Grows one fixed-size segment at a time, see events.odin
+Column :: struct($T: typeid) {
+	segments: [dynamic][^]T,
+	len: int,
+	first_cap: int,
+}
+
 Depth :: struct {
 	tree: []ChunkNode,
-	events: [dynamic]Event,
+	tree_buf: []ChunkNode, // tree gets carved out of this, so rebuilds can reuse it, see reuse_slice
 	leaf_count:   int,
 	overhang_len: int,
 	full_leaves: int,
+	tree_event_count: int, // may lag behind the event count while a file is still loading
+
+	// the last leaf keeps growing between builds, these are its running totals, see patch_lod_spine
+	open_leaf_folded:  int,
+	open_leaf_weights: [COLOR_CHOICES]i64,
+
+	// columnar event storage, one entry per event
+	names:     Column(u32),
+	starts:    Column(u32), // offset from bucket_starts[idx / BUCKET_SIZE]
+	durations: Column(u32),
+
+	// one entry per BUCKET_SIZE events
+	bucket_starts: Column(i64),
+
+	// sparse, sorted by idx
+	args:           [dynamic]ArgEntry,
+	wide_starts:    [dynamic]WideEntry,
+	wide_durations: [dynamic]WideEntry,
+
+	// per-name aggregates over blocks of events, see summary.odin
+	agg_levels: []AggLevel,
+
+	// event indices sorted by name, and which tree nodes hold a search hit, see search.odin
+	name_index: []u32,
+	hit_bits:   []u64,
+	name_index_buf: []u32, // kept across follow-mode rebuilds, see reuse_slice
+	hit_bits_buf:   []u64,
+
+	// while following, events past name_index that have been checked for hits, and how many hit
+	tail_checked: int,
+	tail_hits:    int,
+	search_stale: bool,
+
+	// busy time and colour over the whole trace, for the minimap, see activity.odin
+	activity: ActivityMip,
+
+	// what we drew last frame, and the selected range (if any), see rect_cache.odin
+	rect_cache: RectCache,
+	selected_range: i32,
 }
 
 EVData :: struct {
@@ -285,6 +384,9 @@ Thread :: struct {
 
 	bande_q: Stack(EVData),
 	zero_patchup: i64,
+
+	// got new events since the last follow update, see follow.odin
+	touched: bool,
 }
 
 Process :: struct {
@@ -305,7 +407,7 @@ init_process :: proc(process_id: u32) -> Process {
 		min_time = 0x7fefffffffffffff, 
 		id = process_id,
 		threads = make([dynamic]Thread, small_global_allocator),
-		thread_map = vh_init(scratch_allocator),
+		thread_map = vh_init(loader_allocator()),
 		instants = make([dynamic]Instant, big_global_allocator),
 		in_stats = true,
 	}
@@ -328,7 +430,7 @@ init_thread :: proc(thread_id: u32) -> Thread {
 		zero_patchup = -1,
 	}
 
-	stack_init(&t.bande_q, scratch_allocator)
+	stack_init(&t.bande_q, loader_allocator())
 	return t
 }
 get_thread_name :: proc(trace: ^Trace, thread: ^Thread) -> string {
@@ -80,9 +80,14 @@ draw_histogram :: proc(trace: ^Trace, header: string, stat: ^Stats, pos: Vec2, g
 	graph_edge_pad : f64 = 2 * em
 	line_gap := (em / 1.5)
 
-	history := stat.hist
+	history: [100]f64
+	low_time, high_time := sketch_histogram(&stat.sketch, history[:])
 	temp_history := make([]f64, len(history), context.temp_allocator)
 
+	// bins are spaced evenly in log(duration), so the x axis is too
+	log_low  := math.ln(max(low_time, 1))
+	log_high := math.ln(max(high_time, 1))
+
 	max_val : f64 = 0
 	min_val : f64 = max(f64)
 	for entry, i in history {
@@ -149,7 +154,7 @@ draw_histogram :: proc(trace: ^Trace, header: string, stat: ^Stats, pos: Vec2, g
 		x_tac_count := 4
 		for i := 0; i < x_tac_count; i += 1 {
 			cur_perc := f64(i) / f64(x_tac_count - 1)
-			cur_x_val := math.lerp(f64(stat.min_time), f64(stat.max_time), cur_perc)
+			cur_x_val := math.exp(math.lerp(log_low, log_high, cur_perc))
 			cur_x_pos := math.lerp(near_width, far_width, cur_perc)
 
 			cur_x_str := stat_fmt(disp_time(trace, cur_x_val))
@@ -185,8 +190,9 @@ draw_histogram :: proc(trace: ^Trace, header: string, stat: ^Stats, pos: Vec2, g
 		last_y = point_y
 	}
 
-	if len(temp_history) > 1 {
-		avg_offset := rescale(stat.avg_time, f64(stat.min_time), f64(stat.max_time), near_width, far_width)
+	if len(temp_history) > 1 && log_high > log_low {
+		avg_offset := rescale(math.ln(max(stat.avg_time, 1)), log_low, log_high, near_width, far_width)
+		avg_offset = min(max(avg_offset, near_width), far_width)
 		draw_line(Vec2{avg_offset, graph_top + graph_edge_pad}, Vec2{avg_offset, graph_bottom - graph_edge_pad}, 1, BVec4{255, 0, 0, 255})
 	}
 }
@@ -326,9 +332,37 @@ draw_header :: proc(trace: ^Trace, ui_state: ^UIState) {
 		}
 		cursor_x += button_width + button_pad
 
+		// Follow the End, for files that are still being written, see follow.odin
+		if trace.follow.active {
+			follow_icon := trace.follow.auto_scroll ? "\uf04c" : "\uf04e"
+			follow_tip := trace.follow.auto_scroll ? "stop following the end" : "follow the end"
+			if button(Rect{cursor_x, (header_rect.h / 2) - (button_height / 2), button_width, button_height}, follow_icon, follow_tip, .IconFont, 0, ui_state.width) {
+				trace.follow.auto_scroll = !trace.follow.auto_scroll
+			}
+			cursor_x += button_width + button_pad
+		}
+
+		search_width := 15 * em
+		right_buttons := enable_debug ? 4.0 : 2.0
+		search_x := ui_state.width - edge_pad - ((button_width * right_buttons) + (button_pad * (right_buttons - 1))) - button_pad - search_width
+		draw_search_box(trace, ui_state, Rect{search_x, (header_rect.h / 2) - (button_height / 2), search_width, button_height})
+
+		// Next / Previous Hit, Enter and Shift-Enter do the same from the search box
+		if button(Rect{search_x - button_pad - button_width, (header_rect.h / 2) - (button_height / 2), button_width, button_height}, "\uf078", "next hit", .IconFont, 0, ui_state.width) {
+			jump_to_hit(trace, ui_state, true)
+		}
+		if button(Rect{search_x - ((button_pad + button_width) * 2), (header_rect.h / 2) - (button_height / 2), button_width, button_height}, "\uf077", "previous hit", .IconFont, 0, ui_state.width) {
+			jump_to_hit(trace, ui_state, false)
+		}
+
+		// keep the file name between the left buttons and the hit buttons, and drop it if it won't fit
 		file_name_width := measure_text(trace.file_name, .H1Size, .DefaultFont)
-		name_x := max((full_flamegraph_rect.w / 2) - (file_name_width / 2), cursor_x)
-		draw_text(trace.file_name, Vec2{name_x, (header_rect.h / 2) - (h1_height / 2)}, .H1Size, .DefaultFont, toolbar_text_color)
+		name_end_x := search_x - ((button_pad + button_width) * 2) - button_pad
+		name_x := min((full_flamegraph_rect.w / 2) - (file_name_width / 2), name_end_x - file_name_width)
+		name_x = max(name_x, cursor_x)
+		if name_x + file_name_width <= name_end_x {
+			draw_text(trace.file_name, Vec2{name_x, (header_rect.h / 2) - (h1_height / 2)}, .H1Size, .DefaultFont, toolbar_text_color)
+		}
 
 		// colormode button nonsense
 		color_text : string
@@ -380,6 +414,18 @@ draw_header :: proc(trace: ^Trace, ui_state: ^UIState) {
 		if button(Rect{ui_state.width - edge_pad - ((button_width * 2) + (button_pad)), (header_rect.h / 2) - (button_height / 2), button_width, button_height}, "\uf188", "toggle debug mode", .IconFont, 0, ui_state.width) {
 			enable_debug = !enable_debug
 		}
+
+		if enable_debug {
+			record_tip := self_trace.want_recording ? "stop recording self-trace" : "record self-trace"
+			if button(Rect{ui_state.width - edge_pad - ((button_width * 3) + (button_pad * 2)), (header_rect.h / 2) - (button_height / 2), button_width, button_height}, self_trace.want_recording ? "\uf04d" : "\uf03d", record_tip, .IconFont, 0, ui_state.width) {
+				self_trace.want_recording = !self_trace.want_recording
+				ui_state.render_one_more = true
+			}
+			if button(Rect{ui_state.width - edge_pad - ((button_width * 4) + (button_pad * 3)), (header_rect.h / 2) - (button_height / 2), button_width, button_height}, "\uf019", "save self-trace", .IconFont, 0, ui_state.width) {
+				self_trace.want_export = true
+				ui_state.render_one_more = true
+			}
+		}
 	}
 }
 
@@ -411,6 +457,16 @@ draw_debug :: proc(ui_state: ^UIState) {
 	buckets_txt_width := measure_text(buckets_str, .PSize, .MonoFont)
 	draw_text(buckets_str, Vec2{ui_state.width - buckets_txt_width - x_subpad, prev_line(&y, em)}, .PSize, .MonoFont, text_color2)
 
+	hit_rate := rect_cache_total_draws > 0 ? (f64(rect_cache_total_hits) / f64(rect_cache_total_draws)) * 100 : 0
+	cache_str := fmt.tprintf("Rect Cache: %d hit, %d shifted, %d missed (%.1f%% overall)", rect_cache_hits, rect_cache_shifts, rect_cache_misses, hit_rate)
+	cache_txt_width := measure_text(cache_str, .PSize, .MonoFont)
+	draw_text(cache_str, Vec2{ui_state.width - cache_txt_width - x_subpad, prev_line(&y, em)}, .PSize, .MonoFont, text_color2)
+
+	self_trace_state := self_trace.full ? "full" : (self_trace.recording ? "recording" : "idle")
+	self_trace_str := fmt.tprintf("Self Trace: %s, %M of %M", self_trace_state, self_trace.pos, SELF_TRACE_SIZE)
+	self_trace_width := measure_text(self_trace_str, .PSize, .MonoFont)
+	draw_text(self_trace_str, Vec2{ui_state.width - self_trace_width - x_subpad, prev_line(&y, em)}, .PSize, .MonoFont, text_color2)
+
 	events_str := fmt.tprintf("Event Count: %d", rect_count - bucket_count)
 	events_txt_width := measure_text(events_str, .PSize, .MonoFont)
 	draw_text(events_str, Vec2{ui_state.width - events_txt_width - x_subpad, prev_line(&y, em)}, .PSize, .MonoFont, text_color2)
@@ -423,11 +479,10 @@ draw_rect_tooltip :: proc(trace: ^Trace, ui_state: ^UIState) {
 	tip_pos += Vec2{1, 2} * em / dpr
 
 	ids := rect_tooltip_rect
-	thread := trace.processes[ids.pid].threads[ids.tid]
-	depth := thread.depths[ids.did]
-	ev := depth.events[ids.eid]
+	thread := &trace.processes[ids.pid].threads[ids.tid]
+	ev := get_event(trace, ids)
 
-	duration := bound_duration(&ev, thread.max_time)
+	duration := bound_duration(ev, thread.max_time)
 
 	rect_tooltip_name := in_getstr(&trace.string_block, ev.name)
 	if ev.duration == -1 {
@@ -574,199 +629,33 @@ draw_flamegraphs :: proc(trace: ^Trace, start_time, end_time: i64, ui_state: ^UI
 				draw_text(get_thread_name(trace, &thread), Vec2{ui_state.side_pad + 5, last_cur_y}, .H2Size, .DefaultFont, text_color)
 			}
 
-			cur_depth_off := 0
 			for &depth, d_idx in thread.depths {
-				tree := depth.tree
-
-				found_rid := -1
-				range_loop: for range, r_idx in trace.selected_ranges {
-					if range.pid == i32(p_idx) && range.tid == i32(t_idx) && range.did == i32(d_idx) {
-						found_rid = r_idx
-						break
-					}
+				row_y := cur_y + (ui_state.rect_height * f64(d_idx))
+				if row_y + ui_state.rect_height < inner_flamegraph_rect.y || row_y > inner_flamegraph_rect.y + inner_flamegraph_rect.h {
+					continue
 				}
 
-				// If we blow this, we're in space
-				tree_stack := [128]int{}
-				stack_len := 0
-
-				tree_stack[0] = 0; stack_len += 1
-				for stack_len > 0 {
-					stack_len -= 1
-
-					tree_idx := tree_stack[stack_len]
-					cur_node := &tree[tree_idx]
-
-					if cur_node.end_time < start_time || cur_node.start_time > end_time {
-						continue
-					}
-
-					time_range := f64(cur_node.end_time - cur_node.start_time)
-					range_width := time_range * cam.current_scale
-
-					// draw summary faketangle
-					min_width := 2.0
-					if (range_width / math.sqrt_f64(CHUNK_NARY_WIDTH)) < min_width {
-
-						y := ui_state.rect_height * f64(d_idx)
-						h := ui_state.rect_height
-
-						x := f64(cur_node.start_time)
-						w := min_width * math.sqrt_f64(CHUNK_NARY_WIDTH)
-						xm := x * cam.target_scale
-
-						r_x   := x * cam.current_scale
-						end_x := r_x + w
-
-						r_x   += cam.pan.x + full_flamegraph_rect.x
-						end_x += cam.pan.x + full_flamegraph_rect.x
-
-						r_x    = max(r_x, 0)
-
-						r_y := cur_y + y
-						dr  := Rect{r_x, r_y, end_x - r_x, h}
-
-						rect_color := cur_node.avg_color
-						grey := greyscale(cur_node.avg_color)
-						if ui_state.multiselecting {
-							if found_rid != -1 {
-								range := trace.selected_ranges[found_rid]   
-								ev_start, ev_end := get_event_range(&depth, tree_idx)
-
-								if !range_in_range(ev_start, ev_end, int(range.start), int(range.end)) {
-									rect_color = grey
-								}
-							} else {
-								rect_color = grey
-							}
-						}
-
-						append(&gl_rects,
-							DrawRect{f32(dr.x), f32(dr.w), BVec4{u8(rect_color.x), u8(rect_color.y), u8(rect_color.z), 255}})
-
-						rect_count += 1
-						bucket_count += 1
-						continue
-					}
-
-					// we're at a bottom node, draw the whole thing
-					child_count := get_child_count(&depth, tree_idx)
-					if child_count <= 0 {
-						event_start_idx, event_end_idx := get_event_range(&depth, tree_idx)
-						scan_arr := depth.events[event_start_idx:event_end_idx]
-						y := ui_state.rect_height * f64(d_idx)
-						h := ui_state.rect_height
-						for &ev, de_id in scan_arr {
-							x := f64(ev.timestamp - trace.total_min_time)
-							duration := f64(bound_duration(&ev, thread.max_time))
-							w := max(duration * cam.current_scale, 2.0)
-							xm := x * cam.target_scale
-
-							// Carefully extract the [start, end] interval of the rect so that we can clip the left
-							// side to 0 before sending it to draw_rect, so we can prevent f32 (f64?) precision
-							// problems drawing a rectangle which starts at a massively huge negative number on
-							// the left.
-							r_x   := x * cam.current_scale
-							end_x := r_x + w
-
-							r_x   += cam.pan.x + full_flamegraph_rect.x
-							end_x += cam.pan.x + full_flamegraph_rect.x
-
-							r_x    = max(r_x, 0)
-
-							r_y := cur_y + y
-							dr := Rect{r_x, r_y, end_x - r_x, h}
-
-							if !rect_in_rect(dr, inner_flamegraph_rect) {
-								continue
-							}
-
-							ev_name := in_getstr(&trace.string_block, ev.name)
-							idx := name_color_idx(ev.name)
-							e_idx := event_start_idx + de_id
-
-							rect_color := trace.color_choices[idx]
-							grey := greyscale(trace.color_choices[idx])
-							if ui_state.multiselecting {
-								if found_rid != -1 {
-									range := trace.selected_ranges[found_rid]   
-									if !val_in_range(i32(e_idx), range.start, range.end - 1) { 
-										rect_color = grey
-									}
-								} else {
-									rect_color = grey
-								}
-							}
-
-							if int(selected_event.pid) == p_idx && int(selected_event.tid) == t_idx &&
-							int(selected_event.did) == d_idx && int(selected_event.eid) == e_idx {
-								rect_color.x += 30
-								rect_color.y += 30
-								rect_color.z += 30
-							}
-
-							append(&gl_rects,
-								DrawRect{f32(dr.x), f32(dr.w), BVec4{u8(rect_color.x), u8(rect_color.y), u8(rect_color.z), 255}})
-							rect_count += 1
+				range, has_range := find_selected_range(trace, &depth, p_idx, t_idx, d_idx)
+				self_trace_begin("update_rect_cache")
+				update_rect_cache(trace, &thread, &depth, range, has_range, start_time, end_time, ui_state.multiselecting)
+				self_trace_end()
 
-							underhang := full_flamegraph_rect.x - dr.x
-							overhang := (full_flamegraph_rect.x + full_flamegraph_rect.w) - dr.x
-							disp_w := min(dr.w - underhang, dr.w, overhang)
+				self_trace_begin("draw_depth_rects")
+				draw_depth_rects(trace, ui_state, &depth, p_idx, t_idx, d_idx, row_y)
+				self_trace_end()
 
-							display_name := ev_name
-							if ev.duration == -1 {
-								display_name = fmt.tprintf("%s (Did Not Finish)", ev_name)
-							}
-
-							text_pad := (em / 2)
-							text_width := int(math.floor((disp_w - (text_pad * 2)) / ch_width))
-							max_chars := max(0, min(len(display_name), text_width))
-							name_str := display_name[:max_chars]
-							str_x := max(dr.x, full_flamegraph_rect.x) + text_pad
-
-							if len(name_str) > 4 || max_chars == len(display_name) {
-								if max_chars != len(display_name) {
-									name_str = fmt.tprintf("%s…", name_str[:len(name_str)-1])
-								}
-
-								draw_text(name_str, Vec2{str_x, dr.y + (ui_state.rect_height / 2) - (em / 2)}, .PSize, .MonoFont, text_color3)
-							}
-
-							if pt_in_rect(mouse_pos, inner_flamegraph_rect) && pt_in_rect(mouse_pos, dr) {
-								set_cursor("pointer")
-								if !rendered_rect_tooltip && !shift_down {
-									rect_tooltip_pos = Vec2{dr.x, dr.y}
-									rect_tooltip_rect = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
-									rendered_rect_tooltip = true
-								}
-
-								if clicked && !shift_down {
-									pressed_event = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
-								}
-								if mouse_up_now && !shift_down {
-									released_event = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
-								}
-								if double_clicked && !shift_down {
-									trace.zoom_event = {i64(p_idx), i64(t_idx), i64(d_idx), i64(e_idx)}
-								}
-							}
-						}
-						continue
-					}
-
-					for i := child_count; i > 0; i -= 1 {
-						next_idx := get_left_child(tree_idx) + i - 1
-						tree_stack[stack_len] = next_idx; stack_len += 1
-					}
-				}
-
-				gl_push_rects(gl_rects[:], (cur_y + (ui_state.rect_height * f64(d_idx))), ui_state.rect_height)
+				self_trace_begin("gl_push_rects")
+				gl_push_rects(gl_rects[:], row_y, ui_state.rect_height)
+				self_trace_end()
 				non_zero_resize(&gl_rects, 0)
 			}
 			cur_y += thread_advance
 		}
 	}
 
+	rect_cache_total_hits  += u64(rect_cache_hits + rect_cache_shifts)
+	rect_cache_total_draws += u64(rect_cache_hits + rect_cache_shifts + rect_cache_misses)
+
 	// relative time back-cover
 	draw_rect(Rect{ui_state.side_pad, full_flamegraph_rect.y, full_flamegraph_rect.w, flamegraph_toptext_height}, bg_color)
 
@@ -815,6 +704,24 @@ draw_flamegraphs :: proc(trace: ^Trace, start_time, end_time: i64, ui_state: ^UI
 	}
 }
 
+// Shades everything past the newest timestamp we've parsed so far
+draw_load_frontier :: proc(trace: ^Trace, ui_state: ^UIState) {
+	inner_flamegraph_rect := ui_state.inner_flamegraph_rect
+	flamegraph_right := inner_flamegraph_rect.x + inner_flamegraph_rect.w
+
+	frontier_x := (f64(trace.total_max_time - trace.total_min_time) * cam.current_scale) + cam.pan.x + ui_state.side_pad
+	frontier_x = max(frontier_x, inner_flamegraph_rect.x)
+	if frontier_x < flamegraph_right {
+		draw_rect(Rect{frontier_x, inner_flamegraph_rect.y, flamegraph_right - frontier_x, inner_flamegraph_rect.h}, shadow_color)
+		draw_line(Vec2{frontier_x, inner_flamegraph_rect.y}, Vec2{frontier_x, inner_flamegraph_rect.y + inner_flamegraph_rect.h}, 2, loading_block_color)
+	}
+
+	progress := int(rescale(f64(trace.parser.offset), 0, f64(trace.parser.total_size), 0, 100))
+	load_str := fmt.tprintf("Loading... %d%%", progress)
+	load_width := measure_text(load_str, .PSize, .DefaultFont)
+	draw_text(load_str, Vec2{flamegraph_right - load_width - em, inner_flamegraph_rect.y + ui_state.top_line_gap}, .PSize, .DefaultFont, text_color2)
+}
+
 draw_global_activity :: proc(trace: ^Trace, highlight_start_x, highlight_end_x: f64, ui_state: ^UIState) {
 	global_activity_rect := ui_state.global_activity_rect
 	full_flamegraph_rect := ui_state.full_flamegraph_rect
@@ -831,7 +738,18 @@ draw_global_activity :: proc(trace: ^Trace, highlight_start_x, highlight_end_x:
 	gl_push_rects(gl_rects[:], global_activity_rect.y, global_activity_rect.h)
 	non_zero_resize(&gl_rects, 0)
 
+	// once the file's loaded we've got a precomputed summary, see activity.odin
+	if len(trace.activity.levels) > 0 {
+		draw_trace_activity(trace, layer_count, ui_state.side_pad, full_flamegraph_rect.w)
+		gl_push_rects(gl_rects[:], global_activity_rect.y, global_activity_rect.h)
+		non_zero_resize(&gl_rects, 0)
+	}
+
 	for &proc_v, p_idx in trace.processes {
+		if len(trace.activity.levels) > 0 {
+			break
+		}
+
 		for &tm, t_idx in proc_v.threads {
 			if len(tm.depths) == 0 {
 				continue
@@ -846,7 +764,9 @@ draw_global_activity :: proc(trace: ^Trace, highlight_start_x, highlight_end_x:
 			stack_len := 0
 
 			alpha := u8(255.0 / f64(layer_count))
-			tree_stack[0] = 0; stack_len += 1
+			if len(tree) > 0 {
+				tree_stack[0] = 0; stack_len += 1
+			}
 			for stack_len > 0 {
 				stack_len -= 1
 
@@ -881,13 +801,20 @@ draw_global_activity :: proc(trace: ^Trace, highlight_start_x, highlight_end_x:
 				if child_count <= 0 {
 					event_count := get_event_count(depth, tree_idx)
 					event_start_idx := get_event_start_idx(depth, tree_idx)
-					scan_arr := depth.events[event_start_idx:event_start_idx+event_count]
-					for &ev, de_id in scan_arr {
+					event_end_idx := event_start_idx + event_count
+					for e_idx := event_start_idx; e_idx < event_end_idx; {
+						ev := depth_event(depth, e_idx)
 						x := f64(ev.timestamp - trace.total_min_time)
-						duration := f64(bound_duration(&ev, thread.max_time))
+						duration := f64(bound_duration(ev, thread.max_time))
 						w := max(duration * wide_scale_x, 2.0)
 						xm := x * wide_scale_x
 
+						// the last leaf can be huge between builds, skip whatever would land under this rect
+						e_idx += 1
+						if event_count > BUCKET_SIZE {
+							e_idx = first_event_ending_after(trace, depth, thread.max_time, e_idx, event_end_idx, i64(x + (w / wide_scale_x)) + 1)
+						}
+
 						// Carefully extract the [start, end] interval of the rect so that we can clip the left
 						// side to 0 before sending it to draw_rect, so we can prevent f32 (f64?) precision
 						// problems drawing a rectangle which starts at a massively huge negative number on
@@ -961,21 +888,28 @@ draw_minimap :: proc(trace: ^Trace, ui_state: ^UIState) {
 
 			for &depth, d_idx in thread.depths {
 				found_rid := -1
-				range_loop: for range, r_idx in trace.selected_ranges {
-					if range.pid == i32(p_idx) && range.tid == i32(t_idx) && range.did == i32(d_idx) {
-						found_rid = r_idx
-						break
-					}
+				if _, ok := find_selected_range(trace, &depth, p_idx, t_idx, d_idx); ok {
+					found_rid = int(depth.selected_range)
 				}
 
 				y := tree_y + (mini_rect_height * f64(d_idx))
 
+				if len(depth.activity.levels) > 0 {
+					draw_depth_activity(trace, &depth, found_rid != -1, ui_state.multiselecting, minimap_rect.x + minimap_pad, minimap_rect.w - (2 * minimap_pad))
+					gl_push_rects(gl_rects[:], y, mini_rect_height)
+					non_zero_resize(&gl_rects, 0)
+					continue
+				}
+
+				// still loading, walk the tree instead
 				// If we blow this, we're in space
 				tree_stack := [128]int{}
 				stack_len := 0
 
 				tree := &depth.tree
-				tree_stack[0] = 0; stack_len += 1
+				if len(depth.tree) > 0 {
+					tree_stack[0] = 0; stack_len += 1
+				}
 				for stack_len > 0 {
 					stack_len -= 1
 
@@ -1002,6 +936,9 @@ draw_minimap :: proc(trace: ^Trace, ui_state: ^UIState) {
 
 						rect_color := cur_node.avg_color
 						grey := greyscale(cur_node.avg_color)
+						if search_active(trace) && !node_has_hit(&depth, tree_idx) {
+							rect_color = grey
+						}
 						if ui_state.multiselecting {
 							if found_rid != -1 {
 								range := trace.selected_ranges[found_rid]   
@@ -1022,14 +959,22 @@ draw_minimap :: proc(trace: ^Trace, ui_state: ^UIState) {
 					child_count := get_child_count(&depth, tree_idx)
 					if child_count <= 0 {
 						event_start_idx, event_end_idx := get_event_range(&depth, tree_idx)
+						oversized := event_end_idx - event_start_idx > BUCKET_SIZE
 						foo := math.sqrt_f64(5)
-						scan_arr := depth.events[event_start_idx:event_end_idx]
-						for &ev, de_id in scan_arr {
+						for e_idx := event_start_idx; e_idx < event_end_idx; {
+							ev_idx := e_idx
+							ev := depth_event(&depth, ev_idx)
 							x := f64(ev.timestamp - trace.total_min_time)
-							duration := f64(bound_duration(&ev, thread.max_time))
+							duration := f64(bound_duration(ev, thread.max_time))
 							w := max(duration * x_scale, 2.0)
 							xm := x * x_scale
 
+							// the last leaf can be huge between builds, skip whatever would land under this rect
+							e_idx += 1
+							if oversized {
+								e_idx = first_event_ending_after(trace, &depth, thread.max_time, e_idx, event_end_idx, i64(x + (w / x_scale)) + 1)
+							}
+
 							// Carefully extract the [start, end] interval of the rect so that we can clip the left
 							// side to 0 before sending it to draw_rect, so we can prevent f32 (f64?) precision
 							// problems drawing a rectangle which starts at a massively huge negative number on
@@ -1044,14 +989,16 @@ draw_minimap :: proc(trace: ^Trace, ui_state: ^UIState) {
 							r_w   := end_x - r_x
 
 							idx := name_color_idx(ev.name)
-							e_idx := event_start_idx + de_id
 
 							rect_color := trace.color_choices[idx]
 							grey := greyscale(trace.color_choices[idx])
+							if search_active(trace) && !name_is_hit(trace, ev.name) {
+								rect_color = grey
+							}
 							if ui_state.multiselecting {
 								if found_rid != -1 {
 									range := trace.selected_ranges[found_rid]   
-									if !val_in_range(i32(e_idx), range.start, range.end - 1) { 
+									if !val_in_range(i32(ev_idx), range.start, range.end - 1) { 
 										rect_color = grey
 									}
 								} else {
@@ -1241,6 +1188,26 @@ draw_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 		ui_state.render_one_more = true
 	}
 
+	tab_bar_x += filter_width + handle_pad
+	calltree_text := "\uf0e8"
+	calltree_width := measure_text(calltree_text, .H2Size, .IconFont)
+	calltree_color := ui_state.calltree_open ? text_color : tabbar_text_color
+	draw_text(calltree_text, Vec2{tab_bar_x, handle_y}, .H2Size, .IconFont, calltree_color)
+	tab_calltree_rect := Rect{tab_bar_x, handle_y, calltree_width, h2_height}
+	if pt_in_rect(mouse_pos, tab_calltree_rect) {
+		set_cursor("pointer")
+	}
+	if clicked && pt_in_rect(clicked_pos, tab_calltree_rect) {
+		ui_state.calltree_open = !ui_state.calltree_open
+		ui_state.stats_pane_scroll_pos = 0
+		ui_state.render_one_more = true
+
+		// the tree doesn't get kept up to date while it's hidden
+		if ui_state.calltree_open && trace.calltree.state == .Stale && ui_state.multiselecting {
+			calltree_selection_changed(trace, ui_state)
+		}
+	}
+
 	// hotpatch position after the update, so we don't have a frame with stale position state
 	if ui_state.filters_open {
 		stats_pane_rect.x = filter_pane_rect.x + filter_pane_rect.w
@@ -1347,8 +1314,8 @@ draw_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 		d_idx := int(selected_event.did)
 		e_idx := int(selected_event.eid)
 
-		thread := trace.processes[p_idx].threads[t_idx]
-		event := thread.depths[d_idx].events[e_idx]
+		thread := &trace.processes[p_idx].threads[t_idx]
+		event := get_event(trace, selected_event)
 		draw_text(in_getstr(&trace.string_block, event.name), Vec2{stats_pane_x, next_line(&y, em)}, .PSize, .MonoFont, text_color)
 
 		if event.args > 0 {
@@ -1356,23 +1323,29 @@ draw_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 			draw_text(fmt.tprintf(" user data: %s", args_str), Vec2{stats_pane_x, next_line(&y, em)}, .PSize, .MonoFont, text_color)
 		}
 		draw_text(fmt.tprintf("start time: %s", time_fmt(disp_time(trace, f64(event.timestamp - trace.total_min_time)))), Vec2{stats_pane_x, next_line(&y, em)}, .PSize, .MonoFont, text_color)
-		draw_text(fmt.tprintf("  duration: %s", time_fmt(disp_time(trace, f64(bound_duration(&event, thread.max_time))))), Vec2{stats_pane_x, next_line(&y, em)}, .PSize, .MonoFont, text_color)
+		draw_text(fmt.tprintf("  duration: %s", time_fmt(disp_time(trace, f64(bound_duration(event, thread.max_time))))), Vec2{stats_pane_x, next_line(&y, em)}, .PSize, .MonoFont, text_color)
 		draw_text(fmt.tprintf(" self time: %s", time_fmt(disp_time(trace, f64(event.self_time)))), Vec2{stats_pane_x, next_line(&y, em)}, .PSize, .MonoFont, text_color)
 
+		// If the call tree's open, it takes over the pane from the stats table
+	} else if ui_state.calltree_open && ui_state.multiselecting {
+		pane_bottom := stats_pane_rect.y + stats_pane_rect.h
+		calltree_pane := Rect{stats_pane_x, pane_gapped_start_y, stats_pane_rect.w - (2 * x_subpad), pane_bottom - pane_gapped_start_y}
+		draw_calltree(trace, ui_state, calltree_pane)
+
 		// If we've got stats cooking already
-	} else if stats_state == .Pass1 || stats_state == .Pass2 {
+	} else if stats_state == .Pass1 {
 		y := pane_gapped_start_y
 		center_x := ui_state.width / 2
 
 		total_count := 0
 		cur_count := 0
 		for range, r_idx in trace.selected_ranges {
-			thread := trace.processes[range.pid].threads[range.tid]
-			events := thread.depths[range.did].events
+			thread := &trace.processes[range.pid].threads[range.tid]
+			event_count := depth_len(&thread.depths[range.did])
 
-			total_count += len(events)
+			total_count += event_count
 			if cur_stat_offset.range_idx > i32(r_idx) {
-				cur_count += len(events)
+				cur_count += event_count
 			} else if cur_stat_offset.range_idx == i32(r_idx) {
 				cur_count += int(cur_stat_offset.event_idx - range.start)
 			}
@@ -1399,7 +1372,8 @@ draw_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 		}
 
 		// If stats are ready to display
-	} else if stats_state == .Finished && ui_state.multiselecting {
+		// The table's ready as soon as Pass1 is done, histograms fill in during Pass2
+	} else if (stats_state == .Pass2 || stats_state == .Finished) && ui_state.multiselecting {
 		y := pane_gapped_start_y
 
 		header_start := y
@@ -1484,6 +1458,16 @@ draw_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 			min_text   := fmt.tprintf("%10s", stat_fmt(disp_time(trace, f64(stat.min_time))))
 			avg_text   := fmt.tprintf("%10s", stat_fmt(disp_time(trace, stat.avg_time)))
 			max_text   := fmt.tprintf("%10s", stat_fmt(disp_time(trace, f64(stat.max_time))))
+
+			// percentiles come out of the sketches, which aren't filled until Pass2 wraps up
+			p50_text  := fmt.tprintf("%10s", "")
+			p99_text  := fmt.tprintf("%10s", "")
+			p999_text := fmt.tprintf("%10s", "")
+			if stats_state == .Finished {
+				p50_text  = fmt.tprintf("%10s", stat_fmt(disp_time(trace, stat.p50)))
+				p99_text  = fmt.tprintf("%10s", stat_fmt(disp_time(trace, stat.p99)))
+				p999_text = fmt.tprintf("%10s", stat_fmt(disp_time(trace, stat.p999)))
+			}
 			count_text := fmt.tprintf("%10s", fmt.tprintf("%d", stat.count))
 
 			text_outf(&cursor, y, self_text, text_color2);   cursor += column_gap
@@ -1498,6 +1482,9 @@ draw_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 
 			text_outf(&cursor, y, min_text, text_color2);   cursor += column_gap
 			text_outf(&cursor, y, avg_text, text_color2);   cursor += column_gap
+			text_outf(&cursor, y, p50_text, text_color2);   cursor += column_gap
+			text_outf(&cursor, y, p99_text, text_color2);   cursor += column_gap
+			text_outf(&cursor, y, p999_text, text_color2);  cursor += column_gap
 			text_outf(&cursor, y, max_text, text_color2);   cursor += column_gap
 			text_outf(&cursor, y, count_text, text_color2);   cursor += column_gap
 
@@ -1582,6 +1569,15 @@ draw_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 		avg_header_text    := fmt.tprintf("%-10s", "   avg.")
 		column_header(&cursor, column_gap, y, pane_start_y, info_pane_rect.h, avg_header_text, .AvgTime)
 
+		p50_header_text    := fmt.tprintf("%-10s", "   p50")
+		column_header(&cursor, column_gap, y, pane_start_y, info_pane_rect.h, p50_header_text, .P50)
+
+		p99_header_text    := fmt.tprintf("%-10s", "   p99")
+		column_header(&cursor, column_gap, y, pane_start_y, info_pane_rect.h, p99_header_text, .P99)
+
+		p999_header_text   := fmt.tprintf("%-10s", "   p99.9")
+		column_header(&cursor, column_gap, y, pane_start_y, info_pane_rect.h, p999_header_text, .P999)
+
 		max_header_text    := fmt.tprintf("%-10s", "   max.")
 		column_header(&cursor, column_gap, y, pane_start_y, info_pane_rect.h, max_header_text, .MaxTime)
 
@@ -1731,6 +1727,30 @@ sort_stats :: proc(trace: ^Trace) {
 				return a.val.avg_time < b.val.avg_time
 			}
 		}
+		case .P50:
+		less = proc(a, b: StatEntry) -> bool {
+			if stat_sort_descending {
+				return a.val.p50 > b.val.p50
+			} else {
+				return a.val.p50 < b.val.p50
+			}
+		}
+		case .P99:
+		less = proc(a, b: StatEntry) -> bool {
+			if stat_sort_descending {
+				return a.val.p99 > b.val.p99
+			} else {
+				return a.val.p99 < b.val.p99
+			}
+		}
+		case .P999:
+		less = proc(a, b: StatEntry) -> bool {
+			if stat_sort_descending {
+				return a.val.p999 > b.val.p999
+			} else {
+				return a.val.p999 < b.val.p999
+			}
+		}
 		case .MaxTime:
 		less = proc(a, b: StatEntry) -> bool {
 			if stat_sort_descending {
@@ -1900,32 +1920,41 @@ process_inputs :: proc(trace: ^Trace, dt: f64, ui_state: ^UIState) -> (i64, i64,
 }
 
 build_selected_ranges :: proc(trace: ^Trace, ui_state: ^UIState) {
+	// ranges index into depths that are still growing
+	if loading_config {
+		return
+	}
+
 	init_stat_state(trace, ui_state)
 
 	// build out ranges
-	for proc_v, p_idx in trace.processes {
-		for thread, t_idx in proc_v.threads {
+	for &proc_v, p_idx in trace.processes {
+		for &thread, t_idx in proc_v.threads {
+			for &depth in thread.depths {
+				depth.selected_range = -1
+			}
+
 			if !thread.in_stats {
 				continue
 			}
 
-			for depth, d_idx in thread.depths {
-				start_idx := find_idx(trace, depth.events[:], i64(trace.stats_start_time))
-				end_idx := find_idx(trace, depth.events[:], i64(trace.stats_end_time))
+			for &depth, d_idx in thread.depths {
+				start_idx := find_idx(trace, &depth, i64(trace.stats_start_time))
+				end_idx := find_idx(trace, &depth, i64(trace.stats_end_time))
 				if start_idx == -1 {
 					start_idx = 0
 				}
 				if end_idx == -1 {
-					end_idx = len(depth.events) - 1
+					end_idx = depth_len(&depth) - 1
 				}
-				scan_arr := depth.events[start_idx:end_idx+1]
+				scan_len := end_idx + 1 - start_idx
 
 				real_start := -1
-				fwd_scan_loop: for i := 0; i < len(scan_arr); i += 1 {
-					ev := scan_arr[i]
+				fwd_scan_loop: for i := 0; i < scan_len; i += 1 {
+					ev := depth_event(&depth, start_idx + i)
 
 					start := f64(ev.timestamp - trace.total_min_time)
-					width := f64(bound_duration(&ev, thread.max_time))
+					width := f64(bound_duration(ev, thread.max_time))
 					if !range_in_range(start, start + width, trace.stats_start_time, trace.stats_end_time) {
 						continue fwd_scan_loop
 					}
@@ -1935,11 +1964,11 @@ build_selected_ranges :: proc(trace: ^Trace, ui_state: ^UIState) {
 				}
 
 				real_end := -1
-				rev_scan_loop: for i := len(scan_arr) - 1; i >= 0; i -= 1 {
-					ev := scan_arr[i]
+				rev_scan_loop: for i := scan_len - 1; i >= 0; i -= 1 {
+					ev := depth_event(&depth, start_idx + i)
 
 					start := f64(ev.timestamp - trace.total_min_time)
-					width := f64(bound_duration(&ev, thread.max_time))
+					width := f64(bound_duration(ev, thread.max_time))
 					if !range_in_range(start, start + width, trace.stats_start_time, trace.stats_end_time) {
 						continue rev_scan_loop
 					}
@@ -1949,11 +1978,14 @@ build_selected_ranges :: proc(trace: ^Trace, ui_state: ^UIState) {
 				}
 
 				if real_start != -1 && real_end != -1 {
+					depth.selected_range = i32(len(trace.selected_ranges))
 					append(&trace.selected_ranges, Range{i32(p_idx), i32(t_idx), i32(d_idx), i32(real_start), i32(real_end)})
 				}
 			}
 		}
 	}
+
+	calltree_selection_changed(trace, ui_state)
 }
 
 init_stat_state :: proc(trace: ^Trace, ui_state: ^UIState) {
@@ -1982,6 +2014,8 @@ process_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 		iter_max := stats_just_started ? INITIAL_ITER : FULL_ITER
 
 		broke_early := false
+		// a summarized depth only costs its edge blocks, the rest get scanned a budget at a time,
+		// same as Pass2. high-cardinality depths and followed files don't get summaries
 		if stats_state == .Pass1 {
 			pass1_range_loop: for range, r_idx in trace.selected_ranges {
 				start_idx := range.start
@@ -1991,39 +2025,44 @@ process_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 					start_idx = max(start_idx, cur_stat_offset.event_idx)
 				}
 
-				thread := trace.processes[range.pid].threads[range.tid]
-				events := thread.depths[range.did].events[start_idx:range.end]
-
-				for &ev, e_idx in events {
-					if event_count > iter_max {
-						cur_stat_offset = StatOffset{i32(r_idx), start_idx + i32(e_idx)}
-						broke_early = true
-						break pass1_range_loop
-					}
-
-					duration := bound_duration(&ev, thread.max_time)
-					name := in_getstr(&trace.string_block, ev.name)
-					s, ok := sm_get(&trace.stats, ev.name)
-					if !ok {
-						s = sm_insert(&trace.stats, ev.name, Stats{min_time = max(i64), max_time = min(i64)})
-					}
+				if event_count > iter_max {
+					cur_stat_offset = StatOffset{i32(r_idx), start_idx}
+					broke_early = true
+					break pass1_range_loop
+				}
 
-					s.count += 1
-					s.total_time += duration
-					s.self_time += ev.self_time
-					s.min_time = min(s.min_time, duration)
-					s.max_time = max(s.max_time, duration)
-					total_tracked_time += duration
+				thread := &trace.processes[range.pid].threads[range.tid]
+				depth := &thread.depths[range.did]
+				if len(depth.agg_levels) > 0 {
+					total_tracked_time += depth_range_stats(trace, thread, int(range.did), int(range.start), int(range.end), &trace.stats)
+					event_count += min(int(range.end - range.start), 2 * AGG_BLOCK_SIZE)
+					continue
+				}
 
-					event_count += 1
+				end_idx := min(int(range.end), int(start_idx) + (iter_max - event_count) + 1)
+				total_tracked_time += scan_range_stats(trace, thread, int(range.did), int(start_idx), end_idx, &trace.stats)
+				event_count += end_idx - int(start_idx)
+				if end_idx < int(range.end) {
+					cur_stat_offset = StatOffset{i32(r_idx), i32(end_idx)}
+					broke_early = true
+					break pass1_range_loop
 				}
+			}
+		}
 
+		if stats_state == .Pass1 && !broke_early {
+			for i := 0; i < len(trace.stats.entries); i += 1 {
+				stat := &trace.stats.entries[i].val
+				stat.avg_time = f64(stat.total_time) / f64(stat.count)
 			}
 
-			if !broke_early {
-				stats_state = .Pass2
-				cur_stat_offset = StatOffset{}
+			self_sort :: proc(a, b: StatEntry) -> bool {
+				return a.val.self_time > b.val.self_time
 			}
+			sm_sort(&trace.stats, self_sort)
+
+			stats_state = .Pass2
+			cur_stat_offset = StatOffset{}
 		}
 
 		if stats_state == .Pass2 {
@@ -2035,30 +2074,20 @@ process_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 					start_idx = max(start_idx, cur_stat_offset.event_idx)
 				}
 
-				thread := trace.processes[range.pid].threads[range.tid]
-				events := thread.depths[range.did].events[start_idx:range.end]
+				thread := &trace.processes[range.pid].threads[range.tid]
+				depth := &thread.depths[range.did]
 
-				for &ev, e_idx in events {
+				for e_idx in int(start_idx)..<int(range.end) {
 					if event_count > iter_max {
-						cur_stat_offset = StatOffset{i32(r_idx), start_idx + i32(e_idx)}
+						cur_stat_offset = StatOffset{i32(r_idx), i32(e_idx)}
 						broke_early = true
 						break pass2_range_loop
 					}
 
-					duration := bound_duration(&ev, thread.max_time)
+					ev := depth_event(depth, e_idx)
+					duration := bound_duration(ev, thread.max_time)
 					s, _ := sm_get(&trace.stats, ev.name)
-
-					idx: u32
-					if (s.max_time - s.min_time <= 0) {
-						idx = 50
-					} else {
-						t := f64(duration - s.min_time) / f64(s.max_time - s.min_time)
-						t = min(1, max(t, 0))
-						t *= 99
-						idx = u32(t)
-					}
-
-					s.hist[idx] += 1
+					sketch_insert(&s.sketch, duration)
 					event_count += 1
 				}
 			}
@@ -2066,14 +2095,15 @@ process_stats :: proc(trace: ^Trace, ui_state: ^UIState) {
 			if !broke_early {
 				for i := 0; i < len(trace.stats.entries); i += 1 {
 					stat := &trace.stats.entries[i].val
-					stat.avg_time = f64(stat.total_time) / f64(stat.count)
+					stat.p50  = sketch_quantile(&stat.sketch, 0.5)
+					stat.p99  = sketch_quantile(&stat.sketch, 0.99)
+					stat.p999 = sketch_quantile(&stat.sketch, 0.999)
 				}
 
-				self_sort :: proc(a, b: StatEntry) -> bool {
-					return a.val.self_time > b.val.self_time
-				}
-				sm_sort(&trace.stats, self_sort)
 				stats_state = .Finished
+				if stat_sort_type == .P50 || stat_sort_type == .P99 || stat_sort_type == .P999 {
+					resort_stats = true
+				}
 			}
 		}
 	}
@@ -455,14 +455,17 @@ ingest_start_time: u64
 start_time: u64
 start_mem: i64
 allocator: mem.Allocator
-start_bench :: proc(name: string, al := context.allocator) {
+// zone is false for benches that span several load callbacks, since they wouldn't nest in the self-trace
+start_bench :: proc(name: string, al := context.allocator, zone := true) {
+	if zone { self_trace_begin(name) }
 	start_time = u64(get_time())
 	allocator = al
 	arena := cast(^Arena)al.data
 	start_mem = i64(u32(arena.offset))
 }
-stop_bench :: proc(name: string) {
+stop_bench :: proc(name: string, zone := true) {
 	end_time := u64(get_time())
+	if zone { self_trace_end() }
 	arena := cast(^Arena)allocator.data
 	end_mem := i64(u32(arena.offset))
 
@@ -471,6 +474,10 @@ stop_bench :: proc(name: string) {
 	fmt.printf("%s -- ran in %fs (%dms), used %M\n", name, f32(time_range) / 1000, time_range, mem_range)
 }
 
+print_arena_usage :: proc(name: string, arena: ^Arena) {
+	fmt.printf("    %s -- live %M, peak %M, wasted %M\n", name, arena.offset - arena.wasted, arena.peak_used, arena.wasted)
+}
+
 save_offset :: proc(alloc: ^mem.Allocator) -> int {
 	arena := cast(^Arena)scratch_allocator.data
 	return arena.offset
@@ -484,3 +491,13 @@ restore_offset :: proc(alloc: ^mem.Allocator, offset: int) {
 zero_slice :: proc(array: $T/[]$E) #no_bounds_check {
 	intrinsics.mem_zero(raw_data(array), size_of(E)*len(array))
 }
+
+// Hands back buf[:count], for things that get rebuilt over and over while a file's loading.
+// big_global never frees, so only go back to it when buf's outgrown, and then grab double,
+// so all the outgrown buffers together never add up to more than the current one.
+reuse_slice :: proc(buf: ^$T/[]$E, count: int) -> []E {
+	if len(buf) < count {
+		buf^ = make([]E, len(buf) == 0 ? count : 2 * count, big_global_allocator)
+	}
+	return buf[:count]
+}
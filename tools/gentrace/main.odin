@@ -1,116 +1,567 @@
 package main
 
 import "core:fmt"
+import "core:math"
+import "core:mem"
 import "core:os"
+import "core:strconv"
+import "core:strings"
+import "core:time"
 import "formats:spall"
 
-buf: [dynamic]u8
+// Synthetic trace generator for loader and renderer benchmarks
+//
+// Every thread is generated on its own, top-level spans laid end to end, each one filled with
+// children from the same duration distribution scaled down by the fanout at every level.
+// Output is streamed a block at a time, so file size is only limited by disk, and the
+// generator is seeded, so a preset + seed is always the same file.
 
-emit_json_event :: proc(tid, ts, dur: int) {
-	name := fmt.tprintf("foo-%d", tid)
-	str := fmt.tprintf("\t\t{{\"cat\":\"function\", \"dur\":%d, \"name\":\"%s\", \"ph\":\"X\", \"pid\":0, \"tid\": %d, \"ts\": %d}},\n", dur, name, tid, ts)
-	append(&buf, str)
+BLOCK_SIZE     :: 256 * 1024
+OUT_FLUSH_SIZE :: 4 * 1024 * 1024
+
+Format :: enum {
+	V3,
+	JSON,
+}
+
+DurDist :: enum {
+	Uniform,
+	Exponential,
+	Pareto, // heavy tail
+}
+
+Params :: struct {
+	procs:            int,
+	threads_per_proc: int,
+	events:           int, // begins across the whole trace
+
+	max_depth:   int,
+	depth_decay: f64, // chance a span gets children, compounding per level
+	fanout:      f64, // how much shorter each level's spans are than their parent's
+
+	names:    int, // distinct event names
+	args_len: int, // bytes of args per event, 0 for none
+
+	dur:          DurDist,
+	mean_dur:     f64, // top-level mean, in ns
+	pareto_alpha: f64,
+
+	unclosed:    f64, // chance a thread ends with a stack of spans that never close
+	zero_bursts: f64, // chance a child slot turns into a burst of zero-length events
+	burst_len:   int,
+
+	format: Format,
+	seed:   u64,
+}
+
+default_params :: Params{
+	procs = 1,
+	threads_per_proc = 4,
+	events = 1_000_000,
+
+	max_depth = 16,
+	depth_decay = 0.8,
+	fanout = 4,
+
+	names = 1000,
+	args_len = 0,
+
+	dur = .Exponential,
+	mean_dur = 1_000_000,
+	pareto_alpha = 1.5,
+
+	unclosed = 0,
+	zero_bursts = 0,
+	burst_len = 32,
+
+	format = .V3,
+	seed = 1,
+}
+
+Preset :: struct {
+	name: string,
+	desc: string,
+	params: Params,
+}
+
+// The benchmark corpus, each one leans on a different part of the loader or renderer
+presets := [?]Preset{
+	{"small", "a quick sanity-check trace", default_params},
+	{"wide", "lots of shallow threads across processes", Params{
+		procs = 8, threads_per_proc = 32, events = 20_000_000,
+		max_depth = 4, depth_decay = 0.6, fanout = 8,
+		names = 1000, dur = .Exponential, mean_dur = 200_000, pareto_alpha = 1.5,
+		burst_len = 32, seed = 1,
+	}},
+	{"deep", "a couple of threads with very deep stacks", Params{
+		procs = 1, threads_per_proc = 2, events = 5_000_000,
+		max_depth = 200, depth_decay = 0.98, fanout = 1.1,
+		names = 500, dur = .Uniform, mean_dur = 50_000_000, pareto_alpha = 1.5,
+		burst_len = 32, seed = 1,
+	}},
+	{"heavy_tail", "pareto durations, a few huge spans over lots of tiny ones", Params{
+		procs = 1, threads_per_proc = 8, events = 10_000_000,
+		max_depth = 24, depth_decay = 0.85, fanout = 4,
+		names = 2000, dur = .Pareto, mean_dur = 1_000_000, pareto_alpha = 1.2,
+		burst_len = 32, seed = 1,
+	}},
+	{"many_names", "high name cardinality, for interning and search", Params{
+		procs = 2, threads_per_proc = 8, events = 10_000_000,
+		max_depth = 12, depth_decay = 0.8, fanout = 4,
+		names = 5_000_000, dur = .Exponential, mean_dur = 1_000_000, pareto_alpha = 1.5,
+		burst_len = 32, seed = 1,
+	}},
+	{"args", "every event carries args", Params{
+		procs = 1, threads_per_proc = 8, events = 5_000_000,
+		max_depth = 12, depth_decay = 0.8, fanout = 4,
+		names = 1000, args_len = 200, dur = .Exponential, mean_dur = 1_000_000, pareto_alpha = 1.5,
+		burst_len = 32, seed = 1,
+	}},
+	{"zero_bursts", "runs of zero-length events, for zero_patchup", Params{
+		procs = 1, threads_per_proc = 4, events = 5_000_000,
+		max_depth = 8, depth_decay = 0.7, fanout = 4,
+		names = 1000, dur = .Exponential, mean_dur = 1_000_000, pareto_alpha = 1.5,
+		zero_bursts = 0.05, burst_len = 64, seed = 1,
+	}},
+	{"unclosed", "every thread ends with spans that never close", Params{
+		procs = 2, threads_per_proc = 4, events = 2_000_000,
+		max_depth = 16, depth_decay = 0.8, fanout = 4,
+		names = 1000, dur = .Exponential, mean_dur = 1_000_000, pareto_alpha = 1.5,
+		unclosed = 1, burst_len = 32, seed = 1,
+	}},
+	{"huge", "~12 GB, for load time and memory ceilings", Params{
+		procs = 4, threads_per_proc = 16, events = 400_000_000,
+		max_depth = 16, depth_decay = 0.8, fanout = 4,
+		names = 10_000, dur = .Pareto, mean_dur = 1_000_000, pareto_alpha = 1.5,
+		zero_bursts = 0.001, burst_len = 16, unclosed = 0.25, seed = 1,
+	}},
+}
+
+// splitmix64, so the output doesn't hinge on whatever core:math/rand does this release
+Rng :: struct {
+	state: u64,
+}
+
+rng_next :: proc(r: ^Rng) -> u64 {
+	r.state += 0x9E3779B97F4A7C15
+	z := r.state
+	z = (z ~ (z >> 30)) * 0xBF58476D1CE4E5B9
+	z = (z ~ (z >> 27)) * 0x94D049BB133111EB
+	return z ~ (z >> 31)
+}
+
+// uniform in (0, 1]
+rng_f64 :: proc(r: ^Rng) -> f64 {
+	return (f64(rng_next(r) >> 11) + 1) * (1.0 / f64(u64(1) << 53))
+}
+
+sample_dur :: proc(g: ^Generator, mean: f64) -> u64 {
+	u := rng_f64(&g.rng)
+
+	d: f64
+	switch g.p.dur {
+	case .Uniform:
+		d = u * 2 * mean
+	case .Exponential:
+		d = -math.ln(u) * mean
+	case .Pareto:
+		alpha := max(g.p.pareto_alpha, 1.01)
+		x_min := mean * (alpha - 1) / alpha
+		d = x_min * math.pow(u, -1 / alpha)
+	}
+	return u64(max(d, 1))
 }
 
-emit_header :: proc() {
-	header := spall.Header{magic = spall.MAGIC, version = 1, timestamp_unit = 1.0, must_be_0 = 0}
-	header_bytes := transmute([size_of(spall.Header)]u8)header
-	append(&buf, ..header_bytes[:])
+Writer :: struct {
+	fd:  os.Handle,
+	buf: [dynamic]u8,
+	bytes_written: i64,
+	next_report: i64,
 }
-emit_begin_event :: proc(name: string, pid, tid, ts: int) {
-	begin := spall.Begin_Event {
-		type = .Begin,
-		pid  = u32(pid),
-		tid  = u32(tid),
-		time = f64(ts),
-		name_len = u8(len(name)),
+
+writer_flush :: proc(w: ^Writer) {
+	if len(w.buf) == 0 {
+		return
 	}
 
-	begin_bytes := transmute([size_of(spall.Begin_Event)]u8)begin
-	append(&buf, ..begin_bytes[:])
-	append(&buf, name)
+	os.write(w.fd, w.buf[:])
+	w.bytes_written += i64(len(w.buf))
+	clear(&w.buf)
 
+	if w.bytes_written >= w.next_report {
+		fmt.eprintf("  wrote %M\n", w.bytes_written)
+		w.next_report += 1024 * 1024 * 1024
+	}
 }
-emit_end_event :: proc(pid, tid, ts: int) {
-	end := spall.End_Event {
-		type = .End,
-		pid  = u32(pid),
-		tid  = u32(tid),
-		time = f64(ts),
+
+Generator :: struct {
+	p:   Params,
+	rng: Rng,
+	out: Writer,
+
+	pid: u32,
+	tid: u32,
+	budget: int, // begins left for this thread
+
+	// v3 block for the current thread
+	block: [dynamic]u8,
+	block_first_ts: u64,
+
+	names: []string,
+	args:  string,
+	first_json_event: bool,
+	num_buf: [32]u8,
+
+	event_count: int,
+}
+
+block_reserve :: proc(g: ^Generator, sz: int, ts: u64) {
+	if len(g.block) > 0 && len(g.block) + sz > BLOCK_SIZE {
+		block_flush(g)
+	}
+	if len(g.block) == 0 {
+		hdr := spall.Manual_Buffer_Header{}
+		append(&g.block, ..mem.ptr_to_bytes(&hdr))
+		g.block_first_ts = ts
 	}
-	end_bytes := transmute([size_of(spall.End_Event)]u8)end
-	append(&buf, ..end_bytes[:])
 }
 
-gen_triangle :: proc(tid, start, end: int) {
-	if end - start <= 0 {
+block_flush :: proc(g: ^Generator) {
+	if len(g.block) <= size_of(spall.Manual_Buffer_Header) {
 		return
 	}
 
-	name := fmt.tprintf("foo-%d", tid)
-	emit_begin_event(name, 0, tid, start)
-	gen_triangle(tid, start + 1, end - 1)
-	emit_end_event(0, tid, end)
+	hdr := (^spall.Manual_Buffer_Header)(raw_data(g.block))
+	hdr^ = spall.Manual_Buffer_Header{
+		size     = u32(len(g.block) - size_of(spall.Manual_Buffer_Header)),
+		pid      = g.pid,
+		tid      = g.tid,
+		first_ts = g.block_first_ts,
+	}
+
+	append(&g.out.buf, ..g.block[:])
+	clear(&g.block)
+	if len(g.out.buf) >= OUT_FLUSH_SIZE {
+		writer_flush(&g.out)
+	}
+}
+
+write_num :: proc(g: ^Generator, val: u64) {
+	append(&g.out.buf, strconv.write_uint(g.num_buf[:], val, 10))
+}
+
+// JSON wants microseconds, we've got ns
+write_json_ts :: proc(g: ^Generator, ts: u64) {
+	write_num(g, ts / 1000)
+	frac := ts % 1000
+	if frac != 0 {
+		append(&g.out.buf, '.')
+		if frac < 100 { append(&g.out.buf, '0') }
+		if frac < 10  { append(&g.out.buf, '0') }
+		write_num(g, frac)
+	}
+}
+
+json_event_start :: proc(g: ^Generator, ph: string, ts: u64) {
+	if !g.first_json_event {
+		append(&g.out.buf, ",\n")
+	}
+	g.first_json_event = false
+
+	append(&g.out.buf, `{"ph":"`)
+	append(&g.out.buf, ph)
+	append(&g.out.buf, `","pid":`)
+	write_num(g, u64(g.pid))
+	append(&g.out.buf, `,"tid":`)
+	write_num(g, u64(g.tid))
+	append(&g.out.buf, `,"ts":`)
+	write_json_ts(g, ts)
 }
 
-/*
-	|---------|
-	 |-------|
-	  |----|
-*/
+emit_begin :: proc(g: ^Generator, ts: u64) {
+	name := g.names[rng_next(&g.rng) % u64(len(g.names))]
+	g.budget -= 1
+	g.event_count += 1
 
-gen_triangles :: proc(tid_count, rank, size: int) {
-	width := rank * 2
-	ts_count := 0
-	for i := 0; i < size; i += 1 {
-		for tid := 0; tid < tid_count; tid += 1 {
-			start := ts_count * width
-			end := (ts_count * width) + width
-			gen_triangle(tid, start, end)
+	switch g.p.format {
+	case .V3:
+		block_reserve(g, size_of(spall.Begin_Event_V2) + len(name) + len(g.args), ts)
+		ev := spall.Begin_Event_V2{type = .Begin, time = ts, name_len = u8(len(name)), args_len = u8(len(g.args))}
+		append(&g.block, ..mem.ptr_to_bytes(&ev))
+		append(&g.block, name)
+		append(&g.block, g.args)
+	case .JSON:
+		json_event_start(g, "B", ts)
+		append(&g.out.buf, `,"name":"`)
+		append(&g.out.buf, name)
+		append(&g.out.buf, `"`)
+		if len(g.args) > 0 {
+			append(&g.out.buf, `,"args":`)
+			append(&g.out.buf, g.args)
+		}
+		append(&g.out.buf, "}")
+		if len(g.out.buf) >= OUT_FLUSH_SIZE {
+			writer_flush(&g.out)
 		}
+	}
+}
 
-		ts_count += 1
+emit_end :: proc(g: ^Generator, ts: u64) {
+	switch g.p.format {
+	case .V3:
+		block_reserve(g, size_of(spall.End_Event_V2), ts)
+		ev := spall.End_Event_V2{type = .End, time = ts}
+		append(&g.block, ..mem.ptr_to_bytes(&ev))
+	case .JSON:
+		json_event_start(g, "E", ts)
+		append(&g.out.buf, "}")
 	}
 }
 
+emit_name :: proc(g: ^Generator, type: spall.Manual_Event_Type, name: string, ts: u64) {
+	switch g.p.format {
+	case .V3:
+		block_reserve(g, size_of(spall.Name_Container) + len(name), ts)
+		ev := spall.Name_Container{type = type, name_len = u8(len(name))}
+		append(&g.block, ..mem.ptr_to_bytes(&ev))
+		append(&g.block, name)
+	case .JSON:
+		if !g.first_json_event {
+			append(&g.out.buf, ",\n")
+		}
+		g.first_json_event = false
 
-/*
-	|-----------------------------|
-	 |------------| |------------|
-	  |----| |---|   |----| |---|
-*/
+		append(&g.out.buf, type == .Name_Thread ? `{"ph":"M","name":"thread_name","pid":` : `{"ph":"M","name":"process_name","pid":`)
+		write_num(g, u64(g.pid))
+		append(&g.out.buf, `,"tid":`)
+		write_num(g, u64(g.tid))
+		append(&g.out.buf, `,"args":{"name":"`)
+		append(&g.out.buf, name)
+		append(&g.out.buf, `"}}`)
+	}
+}
 
-/*
-gen_fractals :: proc(tid_count, start_ts, width: int) {
-	if width <= 0 {
-		return
+// Fills [start, start + dur) with a span and, maybe, children. Returns when the span ends.
+gen_span :: proc(g: ^Generator, start, dur: u64, depth: int) -> u64 {
+	end := start + dur
+	emit_begin(g, start)
+
+	child_chance := math.pow(g.p.depth_decay, f64(depth + 1))
+	if depth + 1 < g.p.max_depth && rng_f64(&g.rng) <= child_chance {
+		child_mean := f64(dur) / g.p.fanout
+		t := start + (rng_next(&g.rng) % max(dur / 16, 1))
+
+		for t < end && g.budget > 0 {
+			// a run of zero-length siblings, all on the same tick
+			if g.p.zero_bursts > 0 && rng_f64(&g.rng) < g.p.zero_bursts {
+				for _ in 0..<g.p.burst_len {
+					if g.budget <= 0 {
+						break
+					}
+					emit_begin(g, t)
+					emit_end(g, t)
+				}
+				t += 1
+				continue
+			}
+
+			child_dur := min(sample_dur(g, child_mean), end - t)
+			t = gen_span(g, t, child_dur, depth + 1)
+
+			gap := rng_next(&g.rng) % max(u64(child_mean / 8), 1)
+			t += gap
+		}
 	}
 
-	for i := 0; i < tid_count; i += 1 {
-		emit_bin_event(i, start_ts, width)
+	emit_end(g, end)
+	return end
+}
+
+gen_thread :: proc(g: ^Generator, pid, tid: u32, budget: int) {
+	g.pid = pid
+	g.tid = tid
+	g.budget = budget
+
+	// stagger the threads a little, so they don't all line up
+	t := rng_next(&g.rng) % u64(max(g.p.mean_dur, 1))
+
+	if tid == 0 {
+		emit_name(g, .Name_Process, fmt.tprintf("proc %d", pid), t)
+	}
+	emit_name(g, .Name_Thread, fmt.tprintf("thread %d", tid), t)
+	for g.budget > 0 {
+		dur := sample_dur(g, g.p.mean_dur)
+		t = gen_span(g, t, dur, 0)
+		t += rng_next(&g.rng) % u64(max(g.p.mean_dur / 4, 1))
 	}
 
-	subdivision := 8
-	seg_width := (width / subdivision) - 1
-	
-	for i := 0; i < subdivision; i += 1 {	
-		gen_fractals(tid_count, start_ts + (i + 1) + (i * seg_width), seg_width)
+	// leave a stack hanging off the end of the thread
+	if rng_f64(&g.rng) < g.p.unclosed {
+		depth := 1 + int(rng_next(&g.rng) % u64(max(g.p.max_depth, 1)))
+		for _ in 0..<depth {
+			emit_begin(g, t)
+			t += 1 + (rng_next(&g.rng) % 1000)
+		}
 	}
+
+	block_flush(g)
+	free_all(context.temp_allocator)
+}
+
+build_args :: proc(args_len: int) -> string {
+	args_len := min(args_len, 255)
+	if args_len == 0 {
+		return ""
+	}
+
+	// needs to stay valid JSON, so pad out a string field
+	prefix := `{"data":"`
+	suffix := `"}`
+	if args_len < len(prefix) + len(suffix) {
+		args_len = len(prefix) + len(suffix)
+	}
+
+	b := strings.builder_make()
+	strings.write_string(&b, prefix)
+	for i in 0..<args_len - len(prefix) - len(suffix) {
+		strings.write_byte(&b, 'a' + u8(i % 26))
+	}
+	strings.write_string(&b, suffix)
+	return strings.to_string(b)
+}
+
+print_usage :: proc() {
+	fmt.eprintf("%v <preset> [-o:out] [-format:v3|json] [-seed:N] [-procs:N] [-threads:N] [-events:N]\n", os.args[0])
+	fmt.eprintf("          [-max_depth:N] [-depth_decay:F] [-fanout:F] [-names:N] [-args:N]\n")
+	fmt.eprintf("          [-dur:uniform|exp|pareto] [-mean_dur:NS] [-alpha:F] [-unclosed:F] [-zero_bursts:F] [-burst_len:N]\n\n")
+	fmt.eprintf("presets:\n")
+	for preset in presets {
+		fmt.eprintf("  %-12s %s\n", preset.name, preset.desc)
+	}
+}
+
+parse_flag :: proc(p: ^Params, out_path: ^string, key, val: string) -> bool {
+	switch key {
+	case "o":           out_path^ = val
+	case "format":
+		switch val {
+		case "v3":   p.format = .V3
+		case "json": p.format = .JSON
+		case: return false
+		}
+	case "dur":
+		switch val {
+		case "uniform": p.dur = .Uniform
+		case "exp":     p.dur = .Exponential
+		case "pareto":  p.dur = .Pareto
+		case: return false
+		}
+	case "seed":        p.seed = strconv.parse_u64(val) or_return
+	case "procs":       p.procs = strconv.parse_int(val) or_return
+	case "threads":     p.threads_per_proc = strconv.parse_int(val) or_return
+	case "events":      p.events = strconv.parse_int(val) or_return
+	case "max_depth":   p.max_depth = strconv.parse_int(val) or_return
+	case "depth_decay": p.depth_decay = strconv.parse_f64(val) or_return
+	case "fanout":      p.fanout = strconv.parse_f64(val) or_return
+	case "names":       p.names = strconv.parse_int(val) or_return
+	case "args":        p.args_len = strconv.parse_int(val) or_return
+	case "mean_dur":    p.mean_dur = strconv.parse_f64(val) or_return
+	case "alpha":       p.pareto_alpha = strconv.parse_f64(val) or_return
+	case "unclosed":    p.unclosed = strconv.parse_f64(val) or_return
+	case "zero_bursts": p.zero_bursts = strconv.parse_f64(val) or_return
+	case "burst_len":   p.burst_len = strconv.parse_int(val) or_return
+	case: return false
+	}
+	return true
 }
-*/
 
 main :: proc() {
-	emit_header()
-	//fmt.fprintf("{{\n\t\"traceEvents\": [\n")
-	//gen_fractals(8, 1_000_000, 20_000_000)
-	gen_triangles(8, 10, 300_000)
-	//fmt.fprintf("\t]\n}}")
-
-	out_file := "big_triangles.spall"
-	if os.write_entire_file(out_file, buf[:]) {
-		//fmt.printf("Done, wrote %v events to %v (%v bytes)\n", len(trace.traceEvents), out_file, len(buf))
-	} else {
-		fmt.eprintf("Problem writing to %v\n", out_file)
+	if len(os.args) < 2 {
+		print_usage()
+		os.exit(1)
+	}
+
+	preset_name := os.args[1]
+	p: Params
+	found := false
+	for preset in presets {
+		if preset.name == preset_name {
+			p = preset.params
+			found = true
+			break
+		}
+	}
+	if !found {
+		fmt.eprintf("Unknown preset %v\n\n", preset_name)
+		print_usage()
+		os.exit(1)
+	}
+
+	out_path := ""
+	for arg in os.args[2:] {
+		if len(arg) < 2 || arg[0] != '-' {
+			print_usage()
+			os.exit(1)
+		}
+
+		key, val := arg[1:], ""
+		if colon := strings.index_byte(arg, ':'); colon != -1 {
+			key, val = arg[1:colon], arg[colon + 1:]
+		}
+		if !parse_flag(&p, &out_path, key, val) {
+			fmt.eprintf("Bad flag %v\n\n", arg)
+			print_usage()
+			os.exit(1)
+		}
+	}
+	p.names = max(p.names, 1)
+	p.fanout = max(p.fanout, 1)
+	p.max_depth = max(p.max_depth, 1)
+
+	if out_path == "" {
+		out_path = fmt.tprintf("%v.%v", preset_name, p.format == .V3 ? "spall" : "json")
+	}
+
+	out_fd, err := os.open(out_path, os.O_WRONLY | os.O_CREATE | os.O_TRUNC, 0o644)
+	if err != nil {
+		fmt.eprintf("%v could not be opened for writing.\n", out_path)
 		os.exit(1)
 	}
+	defer os.close(out_fd)
+
+	g := Generator{p = p, rng = Rng{p.seed}, first_json_event = true}
+	g.out = Writer{fd = out_fd, next_report = 1024 * 1024 * 1024}
+	g.out.buf = make([dynamic]u8, 0, OUT_FLUSH_SIZE + BLOCK_SIZE)
+	g.block = make([dynamic]u8, 0, BLOCK_SIZE)
+
+	g.names = make([]string, p.names)
+	for i in 0..<p.names {
+		g.names[i] = fmt.aprintf("fn_%x", rng_next(&g.rng) % 0xFFFFFFFF)
+	}
+	g.args = build_args(p.args_len)
+
+	start := time.now()
+	switch p.format {
+	case .V3:
+		hdr := spall.Manual_Header{magic = spall.MANUAL_MAGIC, version = 3, timestamp_unit = 1, must_be_0 = 0}
+		append(&g.out.buf, ..mem.ptr_to_bytes(&hdr))
+	case .JSON:
+		append(&g.out.buf, "{\"traceEvents\":[\n")
+	}
+
+	thread_count := p.procs * p.threads_per_proc
+	per_thread := max(p.events / max(thread_count, 1), 1)
+	for pid in 0..<p.procs {
+		for tid in 0..<p.threads_per_proc {
+			gen_thread(&g, u32(pid), u32(tid), per_thread)
+		}
+	}
+
+	if p.format == .JSON {
+		append(&g.out.buf, "\n]}\n")
+	}
+	writer_flush(&g.out)
+
+	elapsed := time.duration_seconds(time.since(start))
+	fmt.printf("Done, wrote %v events across %v threads to %v (%M) in %.2fs\n", g.event_count, thread_count, out_path, g.out.bytes_written, elapsed)
 }
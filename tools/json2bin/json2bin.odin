@@ -1,97 +1,851 @@
 package json2bin
 
 import "core:fmt"
+import "core:mem"
 import "core:os"
-import "core:encoding/json"
+import "core:slice"
 import "core:strconv"
-import "core:strings"
+import "core:time"
+import "core:encoding/json"
 import "formats:spall"
 
-Trace :: struct {
-	displayTimeUnit: string,
-	otherData: map[string]any,
-	traceEvents: []struct{
-		cat:  string,
-		dur:  f64,
-		name: string,
-		ph:   string,
-		pid:  u32,
-		tid:  u32,
-		ts:   f64,
+// Streams a Chrome JSON trace into a v3 spall file, a window at a time.
+//
+// The tokenizer is the same table-driven state machine the viewer streams JSON with
+// (src/json.odin), running over a refillable read window instead of browser chunks.
+// v3 wants every thread's events as a time-ordered Begin/End stream, and JSON doesn't promise
+// any order at all, so each thread stages events in a bounded buffer that gets sorted and
+// written out half at a time. Anything that shows up after its spot has already been written
+// gets clamped forward, like the viewer does for zero-length events. Memory scales with the
+// thread count, not the file size.
+
+READ_SIZE   :: 16 * 1024 * 1024
+BLOCK_SIZE  :: 256 * 1024
+PENDING_MAX :: 16 * 1024
+OPEN_END    :: max(u64)
+
+CharType :: enum u8 {
+	Any = 0,
+	ArrOpen,
+	ArrClose,
+	Quote,
+	ObjOpen,
+	ObjClose,
+	Escape,
+	Colon,
+	Comma,
+	Primitive,
+}
+
+PS :: enum u8 {
+	Starting = 0,
+	String,
+	Escape,
+	Colon,
+	ObjOpen,
+	ObjClose,
+	ArrOpen,
+	ArrClose,
+	Comma,
+	Primitive,
+}
+
+char_class := [256]CharType{}
+
+dfa := [?][10]PS{
+	// Any,    ArrOpen, ArrClose,
+	// Quote,  ObjOpen, ObjClose,
+	// Escape, Colon,   Comma, Primitive
+
+	// starting
+	[?]PS{
+		PS.Starting, PS.ArrOpen, PS.ArrClose,
+		PS.String,   PS.ObjOpen, PS.ObjClose,
+		PS.Escape,   PS.Colon,   PS.Comma, PS.Primitive,
+	},
+
+	// string
+	[?]PS{
+		PS.String,   PS.String, PS.String,
+		PS.Starting, PS.String, PS.String,
+		PS.Escape,   PS.String, PS.String, PS.String,
+	},
+
+	// escape
+	[?]PS{
+		PS.String, PS.String, PS.String,
+		PS.String, PS.String, PS.String,
+		PS.String, PS.String, PS.String, PS.String,
+	},
+
+	// colon
+	[?]PS{
+		PS.Starting, PS.ArrOpen, PS.ArrClose,
+		PS.String,   PS.ObjOpen, PS.ObjClose,
+		PS.Escape,   PS.Colon,   PS.Comma,  PS.Primitive,
+	},
+
+	// []{}
+	[?]PS{
+		PS.Starting, PS.ArrOpen,  PS.ArrClose,
+		PS.String,   PS.ObjOpen,  PS.ObjClose,
+		PS.Escape,   PS.Colon,    PS.Comma, PS.Primitive,
+	},
+	[?]PS{
+		PS.Starting, PS.ArrOpen,  PS.ArrClose,
+		PS.String,   PS.ObjOpen,  PS.ObjClose,
+		PS.Escape,   PS.Colon,    PS.Comma, PS.Primitive,
+	},
+	[?]PS{
+		PS.Starting, PS.ArrOpen,  PS.ArrClose,
+		PS.String,   PS.ObjOpen,  PS.ObjClose,
+		PS.Escape,   PS.Colon,    PS.Comma, PS.Primitive,
+	},
+	[?]PS{
+		PS.Starting, PS.ArrOpen,  PS.ArrClose,
+		PS.String,   PS.ObjOpen,  PS.ObjClose,
+		PS.Escape,   PS.Colon,    PS.Comma, PS.Primitive,
+	},
+
+	// ,
+	[?]PS{
+		PS.Starting, PS.ArrOpen,  PS.ArrClose,
+		PS.String,   PS.ObjOpen,  PS.ObjClose,
+		PS.Escape,   PS.Colon,    PS.Comma, PS.Primitive,
+	},
+
+	// -, ., 0-9, t, f, n
+	[?]PS{
+		PS.Starting, PS.ArrOpen,  PS.ArrClose,
+		PS.Starting,  PS.ObjOpen,  PS.ObjClose,
+		PS.Starting,  PS.Starting, PS.Comma, PS.Primitive,
 	},
 }
 
+init_char_classes :: proc() {
+	char_class[u8('{')] = .ObjOpen
+	char_class[u8('}')] = .ObjClose
+	char_class[u8('"')] = .Quote
+	char_class[u8('[')] = .ArrOpen
+	char_class[u8(']')] = .ArrClose
+	char_class[u8('\\')] = .Escape
+	char_class[u8(':')] = .Colon
+	char_class[u8(',')] = .Comma
+
+	char_class[u8('-')] = .Primitive
+	for i : u8 = 0; i < 10; i += 1 {
+		char_class[u8('0') + i] = .Primitive
+	}
+	char_class[u8('t')] = .Primitive
+	char_class[u8('f')] = .Primitive
+	char_class[u8('n')] = .Primitive
+	char_class[u8('.')] = .Primitive
+}
+
+FieldType :: enum u8 {
+	Invalid = 0,
+	Args,
+	Dur,
+	Name,
+	Pid,
+	Tid,
+	Ts,
+	Ph,
+}
+
+// strings point into the read window, so they're only good until the next refill
+JSONEvent :: struct {
+	ph:   u8,
+	name: string,
+	args: string,
+	ts:   f64,
+	dur:  f64,
+	pid:  u32,
+	tid:  u32,
+}
+
+field_type :: proc(key: string) -> FieldType {
+	switch key {
+	case "args": return .Args
+	case "dur":  return .Dur
+	case "name": return .Name
+	case "pid":  return .Pid
+	case "tid":  return .Tid
+	case "ts":   return .Ts
+	case "ph":   return .Ph
+	}
+	return .Invalid
+}
+
+set_field :: proc(ev: ^JSONEvent, key: FieldType, value: string) -> (ok: bool) {
+	#partial switch key {
+	case .Name:
+		ev.name = value
+	case .Ph:
+		if len(value) != 1 {
+			return false
+		}
+		ev.ph = value[0]
+	case .Dur:
+		ev.dur = strconv.parse_f64(value) or_return
+	case .Ts:
+		ev.ts = strconv.parse_f64(value) or_return
+	case .Pid:
+		pid := strconv.parse_u64(value) or_return
+		ev.pid = u32(pid)
+	case .Tid:
+		tid := strconv.parse_u64(value) or_return
+		ev.tid = u32(tid)
+	}
+	return true
+}
+
+// Tokenizes one event object, buf[0] must be the opening {.
+// Returns the bytes it used, or 0 if the object runs past the end of buf.
+scan_event :: proc(buf: []u8, ev: ^JSONEvent) -> (consumed: int, ok: bool) #no_bounds_check {
+	state := PS.Starting
+
+	str_start := 0
+	primitive_start := 0
+	args_start := 0
+	in_string := false
+	in_primitive := false
+	in_key := false
+	key_type := FieldType.Invalid
+
+	depth_count := 0
+	for i := 0; i < len(buf); i += 1 {
+		class := char_class[buf[i]]
+		next_state := dfa[state][class]
+		state = next_state
+
+		if next_state != .String && next_state != .Escape && in_string {
+			str := string(buf[str_start:i])
+			if depth_count == 1 {
+				if in_key {
+					key_type = field_type(str)
+				} else {
+					set_field(ev, key_type, str) or_return
+					key_type = .Invalid
+				}
+			}
+
+			in_string = false
+		} else if next_state != .Primitive && in_primitive {
+			str := string(buf[primitive_start:i])
+			if depth_count == 1 {
+				set_field(ev, key_type, str) or_return
+				key_type = .Invalid
+			}
+
+			in_primitive = false
+		}
+
+		#partial switch next_state {
+		case .ArrOpen:
+			in_key = false
+		case .ObjOpen:
+			if depth_count == 1 && key_type == .Args {
+				args_start = i
+			}
+
+			in_key = true
+			depth_count += 1
+		case .ObjClose:
+			in_key = false
+			depth_count -= 1
+
+			if depth_count == 1 && key_type == .Args {
+				str := string(buf[args_start:i+1])
+
+				// skip storing args: {}
+				if len(str) > 2 {
+					ev.args = str
+				}
+
+				key_type = .Invalid
+			} else if depth_count == 0 {
+				return i + 1, true
+			}
+		case .Colon: in_key = false
+		case .Comma: in_key = true
+		case .String:
+			if !in_string {
+				str_start = i + 1
+				in_string = true
+			}
+		case .Primitive:
+			if !in_primitive {
+				primitive_start = i
+				in_primitive = true
+			}
+		}
+	}
+
+	// ran out of window
+	return 0, true
+}
+
+Reader :: struct {
+	fd:  os.Handle,
+	buf: []u8,
+	pos: int,
+	end: int,
+	eof: bool,
+
+	total_read: i64,
+	next_report: i64,
+}
+
+// Slides whatever's left to the front and tops the window back up,
+// growing it if there's a single event that won't fit
+refill :: proc(r: ^Reader) -> bool {
+	if r.eof {
+		return false
+	}
+
+	if r.pos == 0 && r.end == len(r.buf) {
+		new_buf := make([]u8, len(r.buf) * 2)
+		copy(new_buf, r.buf[:r.end])
+		delete(r.buf)
+		r.buf = new_buf
+	} else {
+		copy(r.buf, r.buf[r.pos:r.end])
+		r.end -= r.pos
+		r.pos = 0
+	}
+
+	n, err := os.read(r.fd, r.buf[r.end:])
+	if err != nil || n <= 0 {
+		r.eof = true
+		return false
+	}
+	r.end += n
+	r.total_read += i64(n)
+
+	if r.total_read >= r.next_report {
+		fmt.eprintf("  read %M\n", r.total_read)
+		r.next_report += 1024 * 1024 * 1024
+	}
+	return true
+}
+
+peek :: proc(r: ^Reader) -> (u8, bool) {
+	for r.pos >= r.end {
+		refill(r) or_return
+	}
+	return r.buf[r.pos], true
+}
+
+skip_spaces :: proc(r: ^Reader) -> (u8, bool) {
+	for {
+		ch := peek(r) or_return
+		if ch != ' ' && ch != '\n' && ch != '\r' && ch != '\t' {
+			return ch, true
+		}
+		r.pos += 1
+	}
+}
+
+// Skips forward to just inside the traceEvents array, or the top-level array if there's no wrapper object
+skip_to_events :: proc(r: ^Reader) -> bool {
+	ch := skip_spaces(r) or_return
+	if ch == '[' {
+		r.pos += 1
+		return true
+	}
+	if ch != '{' {
+		fmt.eprintf("Your JSON file is invalid! got %c, expected [ or {{\n", ch)
+		return false
+	}
+
+	key_buf: [64]u8
+	key_len := 0
+	depth := 0
+	in_string := false
+	for {
+		ch := peek(r) or_return
+		r.pos += 1
+
+		if in_string {
+			switch ch {
+			case '\\':
+				peek(r) or_return
+				r.pos += 1
+				key_len = len(key_buf) + 1 // no escapes in the key we want
+			case '"':
+				in_string = false
+				if depth != 1 || key_len > len(key_buf) || string(key_buf[:key_len]) != "traceEvents" {
+					continue
+				}
+
+				ch = skip_spaces(r) or_return
+				if ch != ':' {
+					fmt.eprintf("Your JSON file is invalid! got %c, expected :\n", ch)
+					return false
+				}
+				r.pos += 1
+
+				ch = skip_spaces(r) or_return
+				if ch != '[' {
+					fmt.eprintf("Your JSON file is invalid! got %c, expected [\n", ch)
+					return false
+				}
+				r.pos += 1
+				return true
+			case:
+				if key_len < len(key_buf) {
+					key_buf[key_len] = ch
+				}
+				key_len += 1
+			}
+			continue
+		}
+
+		switch ch {
+		case '"':
+			in_string = true
+			key_len = 0
+		case '{', '[': depth += 1
+		case '}', ']': depth -= 1
+		}
+	}
+}
+
+PendingEvent :: struct {
+	seq:  u64,
+	ts:   u64,
+	end:  u64, // OPEN_END for a B that hasn't seen its E yet
+	name_off: u32,
+	args_off: u32,
+	name_len: u8,
+	args_len: u8,
+}
+
+OpenSpan :: struct {
+	seq:   u64,
+	start: u64,
+	end:   u64,
+}
+
+OpenBegin :: struct {
+	seq: u64,
+	ts:  u64,
+}
+
+ThreadState :: struct {
+	pid: u32,
+	tid: u32,
+
+	pending:   [dynamic]PendingEvent,
+	strs:      [dynamic]u8,
+	strs_back: [dynamic]u8,
+
+	b_stack: [dynamic]OpenBegin, // B events still waiting on their E
+	staged_ends: map[u64]u64,    // B events still in pending, and the end their E gave them (OPEN_END until then)
+	open:    [dynamic]OpenSpan, // written begins that haven't had their end written
+	last_ts: u64,
+
+	// events that showed up behind last_ts and got moved up to it, and the furthest any moved
+	reordered: int,
+	max_shift: u64,
+
+	block: [dynamic]u8,
+	block_first_ts: u64,
+}
+
+Converter :: struct {
+	out: os.Handle,
+	threads: map[u64]^ThreadState,
+	next_seq: u64,
+
+	bytes_written: i64,
+	event_count:   int,
+	reordered:     int,
+	unmatched_ends: int,
+	dropped:       int,
+	dropped_args:  int,
+}
+
+get_thread :: proc(c: ^Converter, pid, tid: u32) -> ^ThreadState {
+	key := (u64(pid) << 32) | u64(tid)
+	t, ok := c.threads[key]
+	if !ok {
+		t = new(ThreadState)
+		t.pid = pid
+		t.tid = tid
+		c.threads[key] = t
+	}
+	return t
+}
+
+to_ticks :: proc(us: f64) -> u64 {
+	return u64(max(us, 0) * 1000)
+}
+
+// Makes sure the thread's block has room for sz more bytes, writing it out if it doesn't
+block_reserve :: proc(c: ^Converter, t: ^ThreadState, sz: int) {
+	if len(t.block) > 0 && len(t.block) + sz > BLOCK_SIZE {
+		flush_block(c, t)
+	}
+
+	if len(t.block) == 0 {
+		hdr := spall.Manual_Buffer_Header{}
+		append(&t.block, ..mem.ptr_to_bytes(&hdr))
+		t.block_first_ts = OPEN_END
+	}
+}
+
+flush_block :: proc(c: ^Converter, t: ^ThreadState) {
+	if len(t.block) <= size_of(spall.Manual_Buffer_Header) {
+		return
+	}
+
+	hdr := (^spall.Manual_Buffer_Header)(raw_data(t.block))
+	hdr.size = u32(len(t.block) - size_of(spall.Manual_Buffer_Header))
+	hdr.pid = t.pid
+	hdr.tid = t.tid
+	hdr.first_ts = t.block_first_ts == OPEN_END ? t.last_ts : t.block_first_ts
+
+	os.write(c.out, t.block[:])
+	c.bytes_written += i64(len(t.block))
+	clear(&t.block)
+}
+
+write_begin :: proc(c: ^Converter, t: ^ThreadState, ts: u64, name, args: string) {
+	block_reserve(c, t, size_of(spall.Begin_Event_V2) + len(name) + len(args))
+
+	ev := spall.Begin_Event_V2{type = .Begin, time = ts, name_len = u8(len(name)), args_len = u8(len(args))}
+	append(&t.block, ..mem.ptr_to_bytes(&ev))
+	append(&t.block, name)
+	append(&t.block, args)
+
+	t.block_first_ts = min(t.block_first_ts, ts)
+	c.event_count += 1
+}
+
+write_end :: proc(c: ^Converter, t: ^ThreadState, ts: u64) {
+	block_reserve(c, t, size_of(spall.End_Event_V2))
+
+	ev := spall.End_Event_V2{type = .End, time = ts}
+	append(&t.block, ..mem.ptr_to_bytes(&ev))
+
+	t.block_first_ts = min(t.block_first_ts, ts)
+	t.last_ts = max(t.last_ts, ts)
+}
+
+write_name :: proc(c: ^Converter, t: ^ThreadState, type: spall.Manual_Event_Type, name: string) {
+	name := name[:min(len(name), 255)]
+	block_reserve(c, t, size_of(spall.Name_Container) + len(name))
+
+	ev := spall.Name_Container{type = type, name_len = u8(len(name))}
+	append(&t.block, ..mem.ptr_to_bytes(&ev))
+	append(&t.block, name)
+}
+
+// Writes ends for every open span that's done by ts
+close_until :: proc(c: ^Converter, t: ^ThreadState, ts: u64) {
+	for len(t.open) > 0 {
+		top := t.open[len(t.open) - 1]
+		if top.end > ts {
+			break
+		}
+
+		write_end(c, t, max(top.end, top.start))
+		pop(&t.open)
+	}
+}
+
+emit_pending :: proc(c: ^Converter, t: ^ThreadState, ev: PendingEvent) {
+	ts := ev.ts
+	if ts < t.last_ts {
+		c.reordered += 1
+		t.reordered += 1
+		t.max_shift = max(t.max_shift, t.last_ts - ts)
+		ts = t.last_ts
+	}
+	close_until(c, t, ts)
+
+	// v3 is strictly nested, so anything hanging off the end of its parent gets cut off there
+	end := ev.end
+	if len(t.open) > 0 {
+		end = min(end, t.open[len(t.open) - 1].end)
+	}
+	if end != OPEN_END {
+		end = max(end, ts)
+	}
+
+	name := string(t.strs[ev.name_off:ev.name_off + u32(ev.name_len)])
+	args := string(t.strs[ev.args_off:ev.args_off + u32(ev.args_len)])
+	write_begin(c, t, ts, name, args)
+	t.last_ts = ts
+
+	append(&t.open, OpenSpan{ev.seq, ts, end})
+}
+
+pending_less :: proc(a, b: PendingEvent) -> bool {
+	if a.ts != b.ts {
+		return a.ts < b.ts
+	}
+	if a.end != b.end {
+		return a.end > b.end
+	}
+	return a.seq < b.seq
+}
+
+// Sorts the staging buffer and writes out the first count events of it
+flush_pending :: proc(c: ^Converter, t: ^ThreadState, count: int) {
+	if count == 0 {
+		return
+	}
+
+	// B events that got their E while staged pick it up now, so it counts for the sort
+	for &ev in t.pending {
+		if ev.end == OPEN_END {
+			if end, ok := t.staged_ends[ev.seq]; ok {
+				ev.end = end
+			}
+		}
+	}
+
+	slice.sort_by(t.pending[:], pending_less)
+	for ev in t.pending[:count] {
+		emit_pending(c, t, ev)
+		delete_key(&t.staged_ends, ev.seq)
+	}
+
+	// compact whatever's left, and its strings with it
+	remaining := len(t.pending) - count
+	copy(t.pending[:], t.pending[count:])
+	resize(&t.pending, remaining)
+
+	clear(&t.strs_back)
+	for &ev in t.pending {
+		name_off := u32(len(t.strs_back))
+		append(&t.strs_back, ..t.strs[ev.name_off:ev.name_off + u32(ev.name_len)])
+		args_off := u32(len(t.strs_back))
+		append(&t.strs_back, ..t.strs[ev.args_off:ev.args_off + u32(ev.args_len)])
+		ev.name_off = name_off
+		ev.args_off = args_off
+	}
+	t.strs, t.strs_back = t.strs_back, t.strs
+}
+
+stage_event :: proc(c: ^Converter, t: ^ThreadState, ev: ^JSONEvent, ts, end: u64) -> u64 {
+	if len(t.pending) >= PENDING_MAX {
+		flush_pending(c, t, len(t.pending) / 2)
+	}
+
+	name := ev.name[:min(len(ev.name), 255)]
+
+	// cutting args short would leave broken JSON behind, so they go entirely
+	args := ev.args
+	if len(args) > 255 {
+		args = ""
+		c.dropped_args += 1
+	}
+
+	seq := c.next_seq
+	c.next_seq += 1
+
+	pev := PendingEvent{seq = seq, ts = ts, end = end, name_len = u8(len(name)), args_len = u8(len(args))}
+	pev.name_off = u32(len(t.strs))
+	append(&t.strs, name)
+	pev.args_off = u32(len(t.strs))
+	append(&t.strs, args)
+	append(&t.pending, pev)
+
+	return seq
+}
+
+end_span :: proc(c: ^Converter, t: ^ThreadState, ts: u64) {
+	if len(t.b_stack) == 0 {
+		c.unmatched_ends += 1
+		return
+	}
+	b := pop(&t.b_stack)
+	end := max(ts, b.ts)
+
+	// still staged, so it just needs its end filled in, see flush_pending
+	if b.seq in t.staged_ends {
+		t.staged_ends[b.seq] = end
+		return
+	}
+
+	open_idx := -1
+	#reverse for span, i in t.open {
+		if span.seq == b.seq {
+			open_idx = i
+			break
+		}
+	}
+
+	// it got cut off by its parent already
+	if open_idx == -1 {
+		return
+	}
+
+	// anything staged that starts inside the span still has to go out before its end does,
+	// so just set the end, and close_until writes it (and cuts off anything still open inside it) once we get there
+	for i in open_idx..<len(t.open) {
+		t.open[i].end = min(t.open[i].end, end)
+	}
+}
+
+handle_event :: proc(c: ^Converter, ev: ^JSONEvent) {
+	switch ev.ph {
+	case 'X':
+		t := get_thread(c, ev.pid, ev.tid)
+		ts := to_ticks(ev.ts)
+		stage_event(c, t, ev, ts, ts + to_ticks(ev.dur))
+	case 'B':
+		t := get_thread(c, ev.pid, ev.tid)
+		ts := to_ticks(ev.ts)
+		seq := stage_event(c, t, ev, ts, OPEN_END)
+		t.staged_ends[seq] = OPEN_END
+		append(&t.b_stack, OpenBegin{seq, ts})
+	case 'E':
+		t := get_thread(c, ev.pid, ev.tid)
+		end_span(c, t, to_ticks(ev.ts))
+	case 'M':
+		if ev.name != "thread_name" && ev.name != "process_name" {
+			return
+		}
+
+		blob, err := json.parse_string(ev.args, json.DEFAULT_SPECIFICATION, false, context.temp_allocator)
+		defer free_all(context.temp_allocator)
+		if err != nil {
+			c.dropped += 1
+			return
+		}
+
+		arg_map, _ := blob.(json.Object)
+		m_name, ok := arg_map["name"].(json.String)
+		if !ok {
+			c.dropped += 1
+			return
+		}
+
+		t := get_thread(c, ev.pid, ev.tid)
+		write_name(c, t, ev.name == "thread_name" ? .Name_Thread : .Name_Process, m_name)
+	case:
+		// the viewer's v3 parser doesn't read Instant events yet, and v3 has no samples
+		c.dropped += 1
+	}
+}
+
+// Writes out everything that's left. B events that never got an E are left open, so they show up as unfinished.
+finish_thread :: proc(c: ^Converter, t: ^ThreadState) {
+	flush_pending(c, t, len(t.pending))
+	for len(t.open) > 0 {
+		top := t.open[len(t.open) - 1]
+		if top.end == OPEN_END {
+			break
+		}
+
+		write_end(c, t, max(top.end, top.start))
+		pop(&t.open)
+	}
+	flush_block(c, t)
+}
+
 main :: proc() {
 	if len(os.args) < 2 {
-		fmt.eprintf("%v <trace.json>\n", os.args[0])
+		fmt.eprintf("%v <trace.json> [out.spall]\n", os.args[0])
 		os.exit(1)
 	}
 
-	data, ok := os.read_entire_file(os.args[1])
-	defer delete(data)
-	if !ok {
-		fmt.eprintf("%v could not be opened for reading.\n", os.args[1])
+	in_path := os.args[1]
+	out_path := len(os.args) > 2 ? os.args[2] : fmt.tprintf("%v.spall", in_path)
+
+	in_fd, in_err := os.open(in_path, os.O_RDONLY)
+	if in_err != nil {
+		fmt.eprintf("%v could not be opened for reading.\n", in_path)
 		os.exit(1)
 	}
+	defer os.close(in_fd)
 
-	trace: Trace
-	if json.unmarshal(data, &trace) != nil {
-		fmt.eprintf("%v could not be parsed as an event trace.\n", os.args[1])
+	out_fd, out_err := os.open(out_path, os.O_WRONLY | os.O_CREATE | os.O_TRUNC, 0o644)
+	if out_err != nil {
+		fmt.eprintf("%v could not be opened for writing.\n", out_path)
 		os.exit(1)
 	}
+	defer os.close(out_fd)
 
-	buf: [dynamic]u8
-
-	timestamp_unit := 1.0
-	if trace.displayTimeUnit == "ns" { timestamp_unit = 1000 }
+	init_char_classes()
+	start := time.now()
 
-	header := spall.Header{magic = spall.MAGIC, version = 0, timestamp_unit = timestamp_unit, must_be_0 = 0}
-	header_bytes := transmute([size_of(spall.Header)]u8)header
-	append(&buf, ..header_bytes[:])
+	// JSON timestamps are in microseconds, we store nanosecond ticks
+	header := spall.Manual_Header{magic = spall.MANUAL_MAGIC, version = 3, timestamp_unit = 1, must_be_0 = 0}
+	os.write(out_fd, mem.ptr_to_bytes(&header))
 
-	/*
-		{"cat":"function", "name":"main", "ph": "X", "pid": 0, "tid": 0, "ts": 0, "dur": 1},
-		{"cat":"function", "name":"myfunction", "ph": "B", "pid": 0, "tid": 0, "ts": 0},
-		{"cat":"function", "ph": "E", "pid": 0, "tid": 0, "ts": 0}
-	*/
+	c := Converter{out = out_fd}
+	c.bytes_written = size_of(spall.Manual_Header)
+	r := Reader{fd = in_fd, buf = make([]u8, READ_SIZE), next_report = 1024 * 1024 * 1024}
 
-	for event in trace.traceEvents {
-		switch event.ph {
-		case "X", "B": // Complete or Begin Event
-			name_len := min(len(event.name), 255)
-			name     := event.name[:name_len]
+	if !skip_to_events(&r) {
+		fmt.eprintf("%v could not be parsed as an event trace.\n", in_path)
+		os.exit(1)
+	}
 
-			begin := spall.Begin_Event {
-			 	type = .Begin,
-			 	pid  = event.pid,
-			 	tid  = event.tid,
-			 	time = event.ts,
-			 	name_len = u8(name_len),
-		 	}
+	event_loop: for {
+		ch, ok := skip_spaces(&r)
+		if !ok {
+			fmt.eprintf("Trace ends in the middle of the event array, keeping what we've got\n")
+			break event_loop
+		}
 
-			begin_bytes := transmute([size_of(spall.Begin_Event)]u8)begin
-			append(&buf, ..begin_bytes[:])
-			append(&buf, name)
+		switch ch {
+		case ',':
+			r.pos += 1
+			continue event_loop
+		case ']':
+			break event_loop
+		case '{':
+		case:
+			fmt.eprintf("Unable to find next event! got %c\n", ch)
+			os.exit(1)
 		}
 
-		switch event.ph {
-		case "X", "E": // Complete or End Event
-			end := spall.End_Event {
-			 	type = .End,
-			 	pid  = event.pid,
-			 	tid  = event.tid,
-			 	time = event.ts + event.dur,
-		 	}
-			end_bytes := transmute([size_of(spall.End_Event)]u8)end
-			append(&buf, ..end_bytes[:])
+		ev := JSONEvent{}
+		consumed, valid := scan_event(r.buf[r.pos:r.end], &ev)
+		if !valid {
+			fmt.eprintf("Invalid event at byte %v\n", r.total_read - i64(r.end - r.pos))
+			os.exit(1)
+		}
+		if consumed == 0 {
+			if !refill(&r) {
+				fmt.eprintf("Trace ends in the middle of an event, dropping it\n")
+				break event_loop
+			}
+			continue event_loop
 		}
+
+		handle_event(&c, &ev)
+		r.pos += consumed
 	}
-	out_file := fmt.tprintf("%v.spall", os.args[1])
 
-	if os.write_entire_file(out_file, buf[:]) {
-		fmt.printf("Done, wrote %v events to %v (%v bytes)\n", len(trace.traceEvents), out_file, len(buf))
-	} else {
-		fmt.eprintf("Problem writing to %v\n", out_file)
-		os.exit(1)
+	for _, t in c.threads {
+		finish_thread(&c, t)
+	}
+
+	elapsed := time.duration_seconds(time.since(start))
+	fmt.printf("Done, wrote %v events from %v threads to %v (%M) in %.2fs\n", c.event_count, len(c.threads), out_path, c.bytes_written, elapsed)
+	if c.reordered > 0 {
+		fmt.printf("  %v events arrived too far out of order and had their timestamps moved later:\n", c.reordered)
+		for _, t in c.threads {
+			if t.reordered > 0 {
+				fmt.printf("    pid %v tid %v: %v events, worst moved by %.3f us\n", t.pid, t.tid, t.reordered, f64(t.max_shift) / 1000)
+			}
+		}
+	}
+	if c.unmatched_ends > 0 {
+		fmt.printf("  %v E events had no matching B\n", c.unmatched_ends)
+	}
+	if c.dropped > 0 {
+		fmt.printf("  %v instants, samples or unreadable metadata events were dropped\n", c.dropped)
+	}
+	if c.dropped_args > 0 {
+		fmt.printf("  %v events had args over 255 bytes, which were dropped\n", c.dropped_args)
 	}
 }
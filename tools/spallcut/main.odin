@@ -0,0 +1,650 @@
+package main
+
+import "core:fmt"
+import "core:mem"
+import "core:os"
+import "core:strconv"
+import "formats:spall"
+
+// Slices and merges v3 spall files a block at a time
+//
+// slice keeps one time window of a trace. Blocks are walked by their headers, and a block
+// is only re-encoded when it straddles one of the window edges. Blocks inside the window are
+// copied as-is, and once a thread has gone past the end of the window, the rest of its
+// blocks are seeked over. Spans still open at the start of the window get their Begins
+// replayed at the start, and spans still open at the end get closed there.
+//
+// spall.h writes first_ts at flush time, so it's only a loose hint about where a block sits.
+// Instead of trusting it, we lean on each thread's events being in order: once we've seen
+// one past the window, none of that thread's later blocks can be in it.
+//
+// merge concatenates the blocks of several files, giving each file's pids new numbers where
+// they'd clash with an earlier file's. Events are only touched if the timestamp units differ.
+
+OUT_FLUSH_SIZE :: 4 * 1024 * 1024
+
+read_exact :: proc(fd: os.Handle, buf: []u8) -> bool {
+	got := 0
+	for got < len(buf) {
+		n, err := os.read(fd, buf[got:])
+		if err != nil || n <= 0 {
+			return false
+		}
+		got += n
+	}
+	return true
+}
+
+Block_Reader :: struct {
+	fd:   os.Handle,
+	path: string,
+	hdr:  spall.Manual_Header,
+	data: [dynamic]u8,
+}
+
+open_input :: proc(path: string) -> (r: Block_Reader, ok: bool) {
+	fd, err := os.open(path, os.O_RDONLY)
+	if err != nil {
+		fmt.eprintf("%v could not be opened for reading.\n", path)
+		return
+	}
+
+	r.fd = fd
+	r.path = path
+	if !read_exact(fd, mem.ptr_to_bytes(&r.hdr)) || r.hdr.magic != spall.MANUAL_MAGIC {
+		fmt.eprintf("%v isn't a spall file!\n", path)
+		os.close(fd)
+		return
+	}
+	if r.hdr.version != 3 {
+		fmt.eprintf("%v is a v%v file, run it through upconvert first\n", path, r.hdr.version)
+		os.close(fd)
+		return
+	}
+	if r.hdr.timestamp_unit <= 0 {
+		r.hdr.timestamp_unit = 1
+	}
+
+	return r, true
+}
+
+next_block_header :: proc(r: ^Block_Reader) -> (bh: spall.Manual_Buffer_Header, ok: bool) {
+	if !read_exact(r.fd, mem.ptr_to_bytes(&bh)) {
+		return
+	}
+	return bh, true
+}
+
+read_block_data :: proc(r: ^Block_Reader, size: u32) -> ([]u8, bool) {
+	resize(&r.data, int(size))
+	if !read_exact(r.fd, r.data[:]) {
+		fmt.eprintf("%v ends partway through a block, stopping there\n", r.path)
+		return nil, false
+	}
+	return r.data[:], true
+}
+
+skip_block_data :: proc(r: ^Block_Reader, size: u32) -> bool {
+	_, err := os.seek(r.fd, i64(size), os.SEEK_CUR)
+	return err == nil
+}
+
+Writer :: struct {
+	fd:  os.Handle,
+	buf: [dynamic]u8,
+	bytes_written: i64,
+}
+
+writer_flush :: proc(w: ^Writer) {
+	if len(w.buf) == 0 {
+		return
+	}
+
+	os.write(w.fd, w.buf[:])
+	w.bytes_written += i64(len(w.buf))
+	clear(&w.buf)
+}
+
+writer_write :: proc(w: ^Writer, data: []u8) {
+	if len(w.buf) + len(data) > OUT_FLUSH_SIZE {
+		writer_flush(w)
+	}
+
+	// big blocks skip the copy
+	if len(data) >= OUT_FLUSH_SIZE {
+		os.write(w.fd, data)
+		w.bytes_written += i64(len(data))
+		return
+	}
+	append(&w.buf, ..data)
+}
+
+open_output :: proc(path: string, hdr: spall.Manual_Header) -> (w: Writer, ok: bool) {
+	fd, err := os.open(path, os.O_WRONLY | os.O_CREATE | os.O_TRUNC, 0o644)
+	if err != nil {
+		fmt.eprintf("%v could not be opened for writing.\n", path)
+		return
+	}
+
+	w.fd = fd
+	w.buf = make([dynamic]u8, 0, OUT_FLUSH_SIZE)
+	hdr := hdr
+	writer_write(&w, mem.ptr_to_bytes(&hdr))
+	return w, true
+}
+
+Walk_Event :: struct {
+	type: spall.Manual_Event_Type,
+	time: u64, // 0 for names and padding
+	size: int,
+}
+
+// Steps over one event without looking at its name or args. ok is false at the end of the block,
+// or on an event we can't size, which leaves the rest of the block unreadable.
+walk_event :: proc(data: []u8, pos: int) -> (ev: Walk_Event, ok: bool) {
+	rem := len(data) - pos
+	if rem <= 0 {
+		return
+	}
+
+	ev.type = spall.Manual_Event_Type(data[pos])
+	#partial switch ev.type {
+	case .Begin:
+		if rem < size_of(spall.Begin_Event_V2) {
+			return
+		}
+		b := (^spall.Begin_Event_V2)(raw_data(data[pos:]))
+		ev.time = b.time
+		ev.size = size_of(spall.Begin_Event_V2) + int(b.name_len) + int(b.args_len)
+	case .End:
+		if rem < size_of(spall.End_Event_V2) {
+			return
+		}
+		e := (^spall.End_Event_V2)(raw_data(data[pos:]))
+		ev.time = e.time
+		ev.size = size_of(spall.End_Event_V2)
+	case .Name_Process, .Name_Thread:
+		if rem < size_of(spall.Name_Container) {
+			return
+		}
+		n := (^spall.Name_Container)(raw_data(data[pos:]))
+		ev.size = size_of(spall.Name_Container) + int(n.name_len)
+	case .Pad_Skip:
+		if rem < size_of(spall.Pad_Skip) {
+			return
+		}
+		ps := (^spall.Pad_Skip)(raw_data(data[pos:]))
+		ev.size = size_of(spall.Pad_Skip) + int(ps.size)
+	case:
+		return
+	}
+
+	if ev.size > rem {
+		return
+	}
+	return ev, true
+}
+
+thread_key :: #force_inline proc(bh: spall.Manual_Buffer_Header) -> u64 {
+	return (u64(bh.pid) << 32) | u64(bh.tid)
+}
+
+// The viewer puts zero at the earliest event in the file. A thread's earliest event is the first one
+// in its first block, so this reads one block per thread and seeks over everything else.
+find_trace_start :: proc(r: ^Block_Reader) -> (start: u64, ok: bool) {
+	seen := make(map[u64]bool)
+	defer delete(seen)
+
+	start = max(u64)
+	for {
+		bh, more := next_block_header(r)
+		if !more {
+			break
+		}
+
+		key := thread_key(bh)
+		if key in seen {
+			if !skip_block_data(r, bh.size) {
+				break
+			}
+			continue
+		}
+
+		data, read_ok := read_block_data(r, bh.size)
+		if !read_ok {
+			break
+		}
+
+		pos := 0
+		for {
+			ev, walk_ok := walk_event(data, pos)
+			if !walk_ok {
+				break
+			}
+			if ev.type == .Begin || ev.type == .End {
+				start = min(start, ev.time)
+				seen[key] = true
+				break
+			}
+			pos += ev.size
+		}
+	}
+
+	os.seek(r.fd, size_of(spall.Manual_Header), os.SEEK_SET)
+	return start, start != max(u64)
+}
+
+Slice_State :: enum {
+	Before,
+	Inside,
+	Done,
+}
+
+Slice_Thread :: struct {
+	pid: u32,
+	tid: u32,
+	state: Slice_State,
+
+	// Before the window, every Begin that's still open, name and args and all, ready to replay at the start
+	open: [dynamic]u8,
+	open_offs: [dynamic]int,
+	proc_name: [dynamic]u8,
+	thread_name: [dynamic]u8,
+
+	depth: int, // spans open in the output, once we're inside
+}
+
+Slicer :: struct {
+	out: Writer,
+	start: u64,
+	end:   u64,
+	threads: map[u64]^Slice_Thread,
+
+	block: [dynamic]u8,
+	block_first_ts: u64,
+	block_has_ts: bool,
+
+	copied: int,
+	rewritten: int,
+	skimmed: int,
+	skipped: int,
+}
+
+block_start :: proc(s: ^Slicer) {
+	clear(&s.block)
+	hdr := spall.Manual_Buffer_Header{}
+	append(&s.block, ..mem.ptr_to_bytes(&hdr))
+	s.block_has_ts = false
+}
+
+block_note_ts :: #force_inline proc(s: ^Slicer, ts: u64) {
+	if !s.block_has_ts {
+		s.block_first_ts = ts
+		s.block_has_ts = true
+	}
+}
+
+block_flush :: proc(s: ^Slicer, t: ^Slice_Thread) {
+	if len(s.block) <= size_of(spall.Manual_Buffer_Header) {
+		return
+	}
+
+	hdr := (^spall.Manual_Buffer_Header)(raw_data(s.block))
+	hdr^ = spall.Manual_Buffer_Header{
+		size     = u32(len(s.block) - size_of(spall.Manual_Buffer_Header)),
+		pid      = t.pid,
+		tid      = t.tid,
+		first_ts = s.block_has_ts ? s.block_first_ts : s.start,
+	}
+	writer_write(&s.out, s.block[:])
+}
+
+// Names the thread and reopens everything it had open, as if it all started at the window's start
+slice_enter :: proc(s: ^Slicer, t: ^Slice_Thread) {
+	append(&s.block, ..t.proc_name[:])
+	append(&s.block, ..t.thread_name[:])
+
+	for off in t.open_offs {
+		b := (^spall.Begin_Event_V2)(&t.open[off])
+		b.time = s.start
+		ev_sz := size_of(spall.Begin_Event_V2) + int(b.name_len) + int(b.args_len)
+		append(&s.block, ..t.open[off:off + ev_sz])
+	}
+	if len(t.open_offs) > 0 {
+		block_note_ts(s, s.start)
+	}
+
+	t.depth = len(t.open_offs)
+	clear(&t.open)
+	clear(&t.open_offs)
+	t.state = .Inside
+}
+
+slice_close :: proc(s: ^Slicer, t: ^Slice_Thread) {
+	for _ in 0..<t.depth {
+		ev := spall.End_Event_V2{type = .End, time = s.end}
+		append(&s.block, ..mem.ptr_to_bytes(&ev))
+	}
+	t.depth = 0
+	t.state = .Done
+}
+
+// If every event in the block is before the window's end, a thread that's already inside
+// can have it copied straight through. Works out where the depth lands if so.
+block_inside :: proc(data: []u8, depth: int, end: u64) -> (new_depth: int, inside: bool) {
+	new_depth = depth
+	pos := 0
+	for pos < len(data) {
+		ev, ok := walk_event(data, pos)
+		if !ok {
+			return depth, false
+		}
+
+		#partial switch ev.type {
+		case .Begin:
+			if ev.time >= end {
+				return depth, false
+			}
+			new_depth += 1
+		case .End:
+			if ev.time >= end {
+				return depth, false
+			}
+			new_depth = max(new_depth - 1, 0)
+		}
+		pos += ev.size
+	}
+	return new_depth, true
+}
+
+// The slow path, for blocks before the window or straddling one of its edges
+slice_block :: proc(s: ^Slicer, t: ^Slice_Thread, data: []u8) {
+	block_start(s)
+
+	pos := 0
+	walk: for pos < len(data) {
+		ev, ok := walk_event(data, pos)
+		if !ok {
+			fmt.eprintf("Unreadable event (%v) in a block for %v:%v, dropping the rest of the block\n", spall.Manual_Event_Type(data[pos]), t.pid, t.tid)
+			break
+		}
+		raw := data[pos:pos + ev.size]
+		pos += ev.size
+
+		#partial switch ev.type {
+		case .Name_Process, .Name_Thread:
+			if t.state == .Before {
+				dst := ev.type == .Name_Process ? &t.proc_name : &t.thread_name
+				clear(dst)
+				append(dst, ..raw)
+			} else {
+				append(&s.block, ..raw)
+			}
+			continue walk
+		case .Begin, .End:
+		case:
+			continue walk
+		}
+
+		if ev.time >= s.end {
+			if t.state == .Before && len(t.open_offs) > 0 {
+				slice_enter(s, t)
+			}
+			slice_close(s, t)
+			break walk
+		}
+
+		if t.state == .Before && ev.time < s.start {
+			if ev.type == .Begin {
+				append(&t.open_offs, len(t.open))
+				append(&t.open, ..raw)
+			} else if len(t.open_offs) > 0 {
+				resize(&t.open, pop(&t.open_offs))
+			}
+			continue walk
+		}
+
+		if t.state == .Before {
+			slice_enter(s, t)
+		}
+		block_note_ts(s, ev.time)
+		append(&s.block, ..raw)
+		if ev.type == .Begin {
+			t.depth += 1
+		} else {
+			t.depth = max(t.depth - 1, 0)
+		}
+	}
+
+	block_flush(s, t)
+}
+
+slice_file :: proc(in_path, out_path: string, start_ms, end_ms: f64) -> bool {
+	r, in_ok := open_input(in_path)
+	if !in_ok {
+		return false
+	}
+	defer os.close(r.fd)
+
+	trace_start, found := find_trace_start(&r)
+	if !found {
+		fmt.eprintf("%v doesn't have any events\n", in_path)
+		return false
+	}
+
+	s := Slicer{}
+	ticks_per_ms := 1_000_000 / r.hdr.timestamp_unit
+	s.start = trace_start + u64(max(start_ms, 0) * ticks_per_ms)
+	s.end   = trace_start + u64(max(end_ms, 0) * ticks_per_ms)
+
+	out_ok: bool
+	s.out, out_ok = open_output(out_path, r.hdr)
+	if !out_ok {
+		return false
+	}
+	defer os.close(s.out.fd)
+
+	for {
+		bh, more := next_block_header(&r)
+		if !more {
+			break
+		}
+
+		key := thread_key(bh)
+		t, ok := s.threads[key]
+		if !ok {
+			t = new(Slice_Thread)
+			t.pid = bh.pid
+			t.tid = bh.tid
+			s.threads[key] = t
+		}
+
+		if t.state == .Done {
+			if !skip_block_data(&r, bh.size) {
+				break
+			}
+			s.skipped += 1
+			continue
+		}
+
+		data, read_ok := read_block_data(&r, bh.size)
+		if !read_ok {
+			break
+		}
+
+		if t.state == .Inside {
+			if depth, inside := block_inside(data, t.depth, s.end); inside {
+				t.depth = depth
+				writer_write(&s.out, mem.ptr_to_bytes(&bh))
+				writer_write(&s.out, data)
+				s.copied += 1
+				continue
+			}
+		}
+
+		was_before := t.state == .Before
+		slice_block(&s, t, data)
+		if was_before && t.state == .Before {
+			s.skimmed += 1
+		} else {
+			s.rewritten += 1
+		}
+	}
+
+	// threads that went quiet with spans open before the window still have them open across it
+	for _, t in s.threads {
+		if t.state == .Before && len(t.open_offs) > 0 {
+			block_start(&s)
+			slice_enter(&s, t)
+			block_flush(&s, t)
+		}
+	}
+	writer_flush(&s.out)
+
+	fmt.printf("Done, wrote %v (%v bytes)\n", out_path, s.out.bytes_written)
+	fmt.printf("  %v blocks copied, %v rewritten at the edges, %v skimmed before the window, %v skipped after it\n", s.copied, s.rewritten, s.skimmed, s.skipped)
+	return true
+}
+
+// Only needed when the units don't match, otherwise merging never looks inside a block
+rescale_block :: proc(data: []u8, scale: f64) -> bool {
+	pos := 0
+	for pos < len(data) {
+		ev, ok := walk_event(data, pos)
+		if !ok {
+			return false
+		}
+
+		#partial switch ev.type {
+		case .Begin:
+			b := (^spall.Begin_Event_V2)(&data[pos])
+			b.time = u64(f64(b.time) * scale)
+		case .End:
+			e := (^spall.End_Event_V2)(&data[pos])
+			e.time = u64(f64(e.time) * scale)
+		}
+		pos += ev.size
+	}
+	return true
+}
+
+merge_files :: proc(out_path: string, in_paths: []string) -> bool {
+	w: Writer
+	out_unit := 0.0
+	claimed := make(map[u32]bool)
+	blocks := 0
+
+	for path, i in in_paths {
+		r, in_ok := open_input(path)
+		if !in_ok {
+			return false
+		}
+		defer os.close(r.fd)
+
+		if i == 0 {
+			out_ok: bool
+			w, out_ok = open_output(out_path, r.hdr)
+			if !out_ok {
+				return false
+			}
+			out_unit = r.hdr.timestamp_unit
+		}
+
+		// the first file sets the unit, so it always goes through untouched
+		needs_rescale := r.hdr.timestamp_unit != out_unit
+		scale := r.hdr.timestamp_unit / out_unit
+		if needs_rescale {
+			fmt.printf("%v: ticks are %vns, rescaling to %vns\n", path, r.hdr.timestamp_unit, out_unit)
+		}
+
+		remap := make(map[u32]u32)
+		defer delete(remap)
+
+		for {
+			bh, more := next_block_header(&r)
+			if !more {
+				break
+			}
+			data, read_ok := read_block_data(&r, bh.size)
+			if !read_ok {
+				break
+			}
+
+			new_pid, seen := remap[bh.pid]
+			if !seen {
+				new_pid = bh.pid
+				for claimed[new_pid] {
+					new_pid += 1
+				}
+				if new_pid != bh.pid {
+					fmt.printf("%v: pid %v is taken, using %v\n", path, bh.pid, new_pid)
+				}
+				claimed[new_pid] = true
+				remap[bh.pid] = new_pid
+			}
+			bh.pid = new_pid
+
+			if needs_rescale {
+				if !rescale_block(data, scale) {
+					fmt.eprintf("%v: unreadable event in a block for %v:%v, rescaling stopped partway\n", path, bh.pid, bh.tid)
+				}
+				bh.first_ts = u64(f64(bh.first_ts) * scale)
+			}
+
+			writer_write(&w, mem.ptr_to_bytes(&bh))
+			writer_write(&w, data)
+			blocks += 1
+		}
+	}
+	writer_flush(&w)
+	os.close(w.fd)
+
+	fmt.printf("Done, merged %v blocks from %v files into %v (%v bytes)\n", blocks, len(in_paths), out_path, w.bytes_written)
+	return true
+}
+
+print_usage :: proc() {
+	fmt.eprintf("%v slice <trace_in.spall> <trace_out.spall> <start_ms> <end_ms>\n", os.args[0])
+	fmt.eprintf("  keeps only the window between start_ms and end_ms, counted from the first event\n")
+	fmt.eprintf("%v merge <trace_out.spall> <trace_in.spall>...\n", os.args[0])
+	fmt.eprintf("  combines per-process traces, renumbering pids that collide\n")
+}
+
+main :: proc() {
+	if len(os.args) < 2 {
+		print_usage()
+		os.exit(1)
+	}
+
+	ok := false
+	switch os.args[1] {
+	case "slice":
+		if len(os.args) != 6 {
+			print_usage()
+			os.exit(1)
+		}
+
+		start_ms, ok1 := strconv.parse_f64(os.args[4])
+		end_ms, ok2 := strconv.parse_f64(os.args[5])
+		if !ok1 || !ok2 || end_ms <= start_ms {
+			fmt.eprintf("The window needs to be two numbers of milliseconds, start before end\n")
+			os.exit(1)
+		}
+
+		ok = slice_file(os.args[2], os.args[3], start_ms, end_ms)
+	case "merge":
+		if len(os.args) < 4 {
+			print_usage()
+			os.exit(1)
+		}
+
+		ok = merge_files(os.args[2], os.args[3:])
+	case:
+		print_usage()
+		os.exit(1)
+	}
+
+	if !ok {
+		os.exit(1)
+	}
+}
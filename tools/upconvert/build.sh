@@ -1 +1 @@
-odin build main.odin -file -o:speed -out:upconvert
+odin build main.odin -file -collection:formats='../../formats' -o:speed -out:upconvert
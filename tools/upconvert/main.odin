@@ -1,8 +1,10 @@
 package main
 
 import "core:fmt"
+import "core:mem"
 import "core:os"
 import "core:strings"
+import "formats:spall"
 
 
 MAGIC :: u64(0x0BADF00D)
@@ -217,12 +219,224 @@ parse_v0_file :: proc(data: []u8) -> (f64, []Event, bool) {
 	}
 }
 
+// v1 files are one interleaved stream with a pid/tid on every event. This demuxes them into per-thread
+// v3 blocks as it goes, so it never holds more than one block per thread, however big the file is.
+V3_BLOCK_SIZE :: 256 * 1024
+READ_SIZE     :: 16 * 1024 * 1024
+
+V3_Thread :: struct {
+	pid: u32,
+	tid: u32,
+	block: [dynamic]u8,
+	first_ts: u64,
+}
+
+V3_Writer :: struct {
+	out: os.Handle,
+	threads: map[u64]^V3_Thread,
+	bytes_written: i64,
+}
+
+v3_get_thread :: proc(w: ^V3_Writer, pid, tid: u32) -> ^V3_Thread {
+	key := (u64(pid) << 32) | u64(tid)
+	t, ok := w.threads[key]
+	if !ok {
+		t = new(V3_Thread)
+		t.pid = pid
+		t.tid = tid
+		w.threads[key] = t
+	}
+	return t
+}
+
+v3_flush_block :: proc(w: ^V3_Writer, t: ^V3_Thread) {
+	if len(t.block) <= size_of(spall.Manual_Buffer_Header) {
+		return
+	}
+
+	hdr := (^spall.Manual_Buffer_Header)(raw_data(t.block))
+	hdr^ = spall.Manual_Buffer_Header{
+		size     = u32(len(t.block) - size_of(spall.Manual_Buffer_Header)),
+		pid      = t.pid,
+		tid      = t.tid,
+		first_ts = t.first_ts,
+	}
+
+	os.write(w.out, t.block[:])
+	w.bytes_written += i64(len(t.block))
+	clear(&t.block)
+}
+
+v3_reserve :: proc(w: ^V3_Writer, t: ^V3_Thread, sz: int, ts: u64) {
+	if len(t.block) > 0 && len(t.block) + sz > V3_BLOCK_SIZE {
+		v3_flush_block(w, t)
+	}
+
+	if len(t.block) == 0 {
+		hdr := spall.Manual_Buffer_Header{}
+		append(&t.block, ..mem.ptr_to_bytes(&hdr))
+		t.first_ts = ts
+	}
+}
+
+// v1 times are f64s in timestamp_unit microseconds, v3 wants integer ticks,
+// so we keep three decimal places by making each tick a thousandth of a v1 unit
+v1_to_ticks :: proc(time: f64) -> u64 {
+	return u64(max(time, 0) * 1000)
+}
+
+upconvert_v1_stream :: proc(in_fd: os.Handle, out_path: string) -> bool {
+	buf := make([]u8, READ_SIZE)
+	pos, end := 0, 0
+	eof := false
+
+	// slides the leftovers down and tops the window back up
+	refill :: proc(fd: os.Handle, buf: []u8, pos, end: ^int, eof: ^bool) -> bool {
+		if eof^ {
+			return false
+		}
+		copy(buf, buf[pos^:end^])
+		end^ -= pos^
+		pos^ = 0
+
+		n, err := os.read(fd, buf[end^:])
+		if err != nil || n <= 0 {
+			eof^ = true
+			return false
+		}
+		end^ += n
+		return true
+	}
+
+	refill(in_fd, buf, &pos, &end, &eof)
+	if end < size_of(V1_Header) {
+		fmt.eprintf("File is too small to be a spall file!\n")
+		return false
+	}
+	in_hdr := (^V1_Header)(raw_data(buf))^
+	pos += size_of(V1_Header)
+
+	out_fd, out_err := os.open(out_path, os.O_WRONLY | os.O_CREATE | os.O_TRUNC, 0o644)
+	if out_err != nil {
+		fmt.eprintf("%v could not be opened for writing.\n", out_path)
+		return false
+	}
+	defer os.close(out_fd)
+
+	w := V3_Writer{out = out_fd}
+	out_hdr := spall.Manual_Header{magic = spall.MANUAL_MAGIC, version = 3, timestamp_unit = in_hdr.timestamp_unit, must_be_0 = 0}
+	os.write(out_fd, mem.ptr_to_bytes(&out_hdr))
+	w.bytes_written = size_of(spall.Manual_Header)
+
+	event_count := 0
+	stream_loop: for {
+		rem := end - pos
+		if rem < size_of(u8) || (rem < size_of(V1_Begin_Event) && !eof) {
+			if !refill(in_fd, buf, &pos, &end, &eof) && end - pos == 0 {
+				break stream_loop
+			}
+			rem = end - pos
+		}
+
+		type := V1_Event_Type(buf[pos])
+		#partial switch type {
+		case .Begin:
+			if rem < size_of(V1_Begin_Event) {
+				break stream_loop
+			}
+			event := (^V1_Begin_Event)(raw_data(buf[pos:]))^
+
+			event_sz := size_of(V1_Begin_Event) + int(event.name_len) + int(event.args_len)
+			if rem < event_sz {
+				if !refill(in_fd, buf, &pos, &end, &eof) {
+					break stream_loop
+				}
+				continue stream_loop
+			}
+
+			name_start := pos + size_of(V1_Begin_Event)
+			args_start := name_start + int(event.name_len)
+
+			ts := v1_to_ticks(event.time)
+			t := v3_get_thread(&w, event.pid, event.tid)
+			v3_reserve(&w, t, size_of(spall.Begin_Event_V2) + int(event.name_len) + int(event.args_len), ts)
+
+			ev := spall.Begin_Event_V2{type = .Begin, time = ts, name_len = event.name_len, args_len = event.args_len}
+			append(&t.block, ..mem.ptr_to_bytes(&ev))
+			append(&t.block, ..buf[name_start:args_start + int(event.args_len)])
+
+			pos += event_sz
+			event_count += 1
+		case .End:
+			if rem < size_of(V1_End_Event) {
+				if !refill(in_fd, buf, &pos, &end, &eof) {
+					break stream_loop
+				}
+				continue stream_loop
+			}
+			event := (^V1_End_Event)(raw_data(buf[pos:]))^
+
+			ts := v1_to_ticks(event.time)
+			t := v3_get_thread(&w, event.pid, event.tid)
+			v3_reserve(&w, t, size_of(spall.End_Event_V2), ts)
+
+			ev := spall.End_Event_V2{type = .End, time = ts}
+			append(&t.block, ..mem.ptr_to_bytes(&ev))
+
+			pos += size_of(V1_End_Event)
+		case .StreamOver:
+			break stream_loop
+		case:
+			fmt.eprintf("Unknown/invalid event (%v) at byte %v, stopping here\n", type, pos)
+			break stream_loop
+		}
+	}
+
+	if end - pos > 0 && !eof {
+		fmt.eprintf("Stopped with %v bytes left in the window\n", end - pos)
+	}
+
+	for _, t in w.threads {
+		v3_flush_block(&w, t)
+	}
+
+	fmt.printf("Done, wrote %v events from %v threads to %v (%v bytes)\n", event_count, len(w.threads), out_path, w.bytes_written)
+	return true
+}
+
 main :: proc() {
-	if len(os.args) < 2 {
-		fmt.eprintf("%v <trace_in.spall> <trace_out.spall>\n", os.args[0])
+	if len(os.args) < 3 {
+		fmt.eprintf("%v <trace_in.spall> <trace_out>\n", os.args[0])
+		fmt.eprintf("  v0 files are converted to v1, v1 files are streamed to v3\n")
 		os.exit(1)
 	}
 
+	out_file := fmt.tprintf("%v.spall", os.args[2])
+
+	in_fd, in_err := os.open(os.args[1], os.O_RDONLY)
+	if in_err != nil {
+		fmt.eprintf("%v could not be opened for reading.\n", os.args[1])
+		os.exit(1)
+	}
+
+	hdr := V1_Header{}
+	n, _ := os.read(in_fd, mem.ptr_to_bytes(&hdr))
+	if n < size_of(V1_Header) || hdr.magic != MAGIC {
+		fmt.eprintf("%v isn't a spall file!\n", os.args[1])
+		os.exit(1)
+	}
+
+	if hdr.version == 1 {
+		os.seek(in_fd, 0, os.SEEK_SET)
+		ok := upconvert_v1_stream(in_fd, out_file)
+		os.close(in_fd)
+		if !ok {
+			os.exit(1)
+		}
+		return
+	}
+	os.close(in_fd)
+
 	data, ok := os.read_entire_file(os.args[1])
 	defer delete(data)
 	if !ok {
@@ -247,7 +461,6 @@ main :: proc() {
 		}
 	}
 
-	out_file := fmt.tprintf("%v.spall", os.args[2])
 	if os.write_entire_file(out_file, buf[:]) {
 	} else {
 		fmt.eprintf("Problem writing to %v\n", out_file)